@@ -0,0 +1,81 @@
+/**
+ *  ofApp.cpp
+ *
+ *	ofxImageSequence decoder benchmark
+ *
+ *  Put the same frames in one folder per format under bin/data/benchmark, like benchmark/jpg,
+ *  benchmark/png and benchmark/qoi. Build with OFX_IMAGE_SEQUENCE_USE_TURBOJPEG and
+ *  OFX_IMAGE_SEQUENCE_USE_SPNG defined to include those decoders. Every folder is decoded with the
+ *  decoder the addon picks for its extension and with FreeImage, once per pixel type. The first
+ *  run of a folder also reads the files from disk, decodeMicros doesn't include that.
+ */
+
+#include "ofApp.h"
+
+//--------------------------------------------------------------
+void ofApp::setup(){
+	ofDirectory formats("benchmark");
+	formats.listDir();
+	formats.sort();
+	for(int i = 0; i < formats.size(); i++){
+		if(!formats.getFile(i).isDirectory()){
+			continue;
+		}
+		string folder = formats.getPath(i);
+		benchmark<unsigned char>(folder, "8 bit");
+		benchmark<unsigned short>(folder, "16 bit");
+		benchmark<float>(folder, "float");
+	}
+	if(results.empty()){
+		ofLogError("ofApp::setup") << "No frame folders found in " << formats.getAbsolutePath();
+	}
+}
+
+template<typename PixelType>
+void ofApp::benchmark(string folder, string pixelType){
+	ofDirectory files(folder);
+	files.listDir();
+	if(files.size() == 0){
+		return;
+	}
+	files.sort();
+	string extension = ofToLower(files.getFile(0).getExtension());
+
+	run<PixelType>(folder, pixelType, extension, false);
+	//extensions without a decoder of their own use FreeImage already
+	if(ofxImageSequence_<PixelType>().getDecoder(extension)->getName() != "FreeImage"){
+		run<PixelType>(folder, pixelType, extension, true);
+	}
+}
+
+//decodes every frame once and reports the decode time the sequence measured
+template<typename PixelType>
+void ofApp::run(string folder, string pixelType, string extension, bool useFreeImage){
+	ofxImageSequence_<PixelType> sequence;
+	if(useFreeImage){
+		sequence.setDecoder(extension, shared_ptr<ofxImageSequenceDecoder>(new ofxImageSequenceFreeImageDecoder()));
+	}
+	sequence.setMemoryBudget(numeric_limits<uint64_t>::max());
+	if(!sequence.loadSequence(folder)){
+		return;
+	}
+	sequence.preloadAllFrames();
+
+	ofxImageSequenceStats stats = sequence.getStats();
+	string result = ofFilePath::getFileName(folder) + ", " + pixelType + ", " + sequence.getDecoder(extension)->getName() + ": " +
+		ofToString(stats.framesDecoded) + " frames, decodeMicros " + ofToString(stats.decodeMicros);
+	if(stats.framesDecoded > 0){
+		result += ", " + ofToString(stats.decodeMicros / 1000.0 / stats.framesDecoded, 2) + "ms per frame";
+	}
+	result += ", " + ofToString(stats.decodedBytes / (1024 * 1024)) + "MB decoded";
+	ofLogNotice("ofApp::run") << result;
+	results.push_back(result);
+}
+
+//--------------------------------------------------------------
+void ofApp::draw(){
+	ofBackground(0);
+	for(int i = 0; i < results.size(); i++){
+		ofDrawBitmapString(results[i], 10, 20 + i * 16);
+	}
+}
@@ -0,0 +1,27 @@
+/**
+ *
+ *	ofxImageSequence decoder benchmark
+ *
+ *  Decodes the same frames with each decoder and with FreeImage, into 8 bit, 16 bit and float
+ *  sequences, and prints the decode time from getStats for each run.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+#include "ofxImageSequence.h"
+
+class ofApp : public ofBaseApp
+{
+
+  public:
+	void setup();
+	void draw();
+
+	template<typename PixelType>
+	void benchmark(string folder, string pixelType);
+	template<typename PixelType>
+	void run(string folder, string pixelType, string extension, bool useFreeImage);
+
+	vector<string> results;
+};
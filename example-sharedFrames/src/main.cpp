@@ -0,0 +1,14 @@
+#include "ofMain.h"
+#include "ofApp.h"
+
+//========================================================================
+int main(int argc, char* argv[]){
+
+	ofSetupOpenGL(1024,768, OF_WINDOW);			// <-------- setup the GL context
+
+	//run it once without arguments to decode and share the frames, then again with "reader"
+	//to show them in a second process
+	bool reader = argc > 1 && string(argv[1]) == "reader";
+	ofRunApp(new ofApp(reader));
+
+}
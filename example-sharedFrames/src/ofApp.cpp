@@ -0,0 +1,123 @@
+/**
+ *  ofApp.cpp
+ *
+ *	ofxImageSequence shared frames example
+ *
+ *  Put the frames in bin/data/frames, start the app without arguments and then start a second
+ *  instance with "reader" as its argument. The first one decodes the frames on its loader thread
+ *  and copies them into shared memory, the second one shows them without decoding anything.
+ */
+
+#include "ofApp.h"
+
+#define SHARED_NAME "/ofxImageSequenceExample"
+
+ofApp::ofApp(bool isReader){
+	reader = isReader;
+}
+
+//--------------------------------------------------------------
+void ofApp::setup(){
+	playing = true;
+	framesChecked = 0;
+	framesMismatched = 0;
+	totalLatencyMicros = 0;
+	maxLatencyMicros = 0;
+
+	if(reader){
+		//only lists the files, the reader loads them itself when checking a frame
+		files.loadSequence("frames");
+		ofSetWindowTitle("reader");
+	}
+	else{
+		sequence.enableThreadedLoad(true);
+		sequence.loadSequence("frames");
+		ofSetWindowTitle("writer");
+	}
+}
+
+//--------------------------------------------------------------
+void ofApp::update(){
+	if(!reader){
+		//frames decoded before sharing started are published right away, the rest as the loader decodes them
+		if(sequence.isLoaded() && !sequence.isSharingFrames()){
+			sequence.shareFrames(SHARED_NAME);
+		}
+		return;
+	}
+
+	//the writer may not be sharing yet, try again every second
+	if(!sequence.isSharingFrames()){
+		if(ofGetFrameNum() % 60 == 0 && sequence.attachSharedFrames(SHARED_NAME)){
+			sharedFrames.attach(SHARED_NAME, sizeof(unsigned char));
+			checked.assign(sequence.getTotalFrames(), false);
+		}
+		return;
+	}
+
+	for(int i = 0; i < checked.size(); i++){
+		if(!checked[i] && sequence.isFrameReady(i)){
+			checkFrame(i);
+		}
+	}
+}
+
+//the latency is from publishing the frame to the reader's update seeing it ready, so it includes up to
+//a couple of updates of polling. the pixels have to match the file decoded here
+void ofApp::checkFrame(int index){
+	checked[index] = true;
+	framesChecked++;
+
+	uint64_t latency = ofGetSystemTimeMicros() - sharedFrames.getPublishTime(index);
+	totalLatencyMicros += latency;
+	maxLatencyMicros = MAX(maxLatencyMicros, latency);
+
+	size_t width, height, channels;
+	const unsigned char* shared = (const unsigned char*)sharedFrames.getFrame(index, width, height, channels);
+	ofPixels pixels;
+	if(shared == NULL || !ofLoadImage(pixels, files.getFilePath(index)) ||
+	   pixels.getWidth() != width || pixels.getHeight() != height || pixels.getNumChannels() != channels ||
+	   memcmp(pixels.getData(), shared, pixels.size()) != 0){
+		ofLogError("ofApp::checkFrame") << "Shared frame " << index << " doesn't match " << files.getFilePath(index);
+		framesMismatched++;
+	}
+}
+
+//--------------------------------------------------------------
+void ofApp::draw(){
+	ofBackground(0);
+	if(sequence.isLoaded()){
+		if(playing){
+			sequence.getTextureForTime(ofGetElapsedTimef()).draw(0, 0);
+		}
+		else{
+			sequence.getTextureForPercent(ofMap(mouseX, 0, ofGetWidth(), 0, 1.0, true)).draw(0, 0);
+		}
+	}
+
+	string status;
+	if(!reader){
+		status = "decoded " + ofToString(sequence.getNumFramesReady()) + " / " + ofToString(sequence.getTotalFrames());
+		if(sequence.isSharingFrames()){
+			status += ", sharing them as " SHARED_NAME;
+		}
+	}
+	else if(!sequence.isSharingFrames()){
+		status = "waiting for the writer to share " SHARED_NAME;
+	}
+	else{
+		status = "checked " + ofToString(framesChecked) + " / " + ofToString(sequence.getTotalFrames()) +
+			", " + ofToString(framesMismatched) + " mismatched";
+		if(framesChecked > 0){
+			status += ", latency " + ofToString(totalLatencyMicros / framesChecked / 1000.0, 1) + "ms average, " +
+				ofToString(maxLatencyMicros / 1000.0, 1) + "ms max";
+		}
+	}
+	ofDrawBitmapString(status, 10, 20);
+}
+
+//--------------------------------------------------------------
+void ofApp::keyPressed(int key){
+	//hit any key to toggle playing, when stopped the mouse scrubs
+	playing = !playing;
+}
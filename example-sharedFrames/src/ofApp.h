@@ -0,0 +1,40 @@
+/**
+ *
+ *	ofxImageSequence shared frames example
+ *
+ *  One process decodes the sequence and shares the frames, a second one attaches to them.
+ *  The reader checks every frame it gets against the file and times how long it took to arrive.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+#include "ofxImageSequence.h"
+
+class ofApp : public ofBaseApp
+{
+
+  public:
+	ofApp(bool reader);
+
+	void setup();
+	void update();
+	void draw();
+
+	void keyPressed(int key);
+
+	void checkFrame(int index);
+
+	bool reader;
+	ofxImageSequence sequence;
+	bool playing;
+
+	//reader only, the files to compare with and the shared region to read the publish times from
+	ofxImageSequence files;
+	ofxImageSequenceSharedFrames sharedFrames;
+	vector<bool> checked;
+	int framesChecked;
+	int framesMismatched;
+	uint64_t totalLatencyMicros;
+	uint64_t maxLatencyMicros;
+};
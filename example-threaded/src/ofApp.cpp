@@ -61,10 +61,11 @@ void ofApp::update(){
 //--------------------------------------------------------------
 void ofApp::draw(){
 	
-	if(sequence.isLoading()){
+	if(!sequence.isLoaded()){
 		ofBackground(255,0,0);
 	}
 	else{
+		//frames can be drawn while the rest are still loading, ones that aren't ready yet show the nearest loaded frame
 		ofBackground(0);
 		if(playing){
 			//get the frame based on the current time and draw it
@@ -78,6 +79,11 @@ void ofApp::draw(){
 			sequence.getFrameAtPercent(percent)->draw(0, 0);
 		}
 	}
+
+	if(sequence.isLoading()){
+		ofDrawBitmapString("loaded " + ofToString(sequence.getNumFramesReady()) + " / " + ofToString(sequence.getTotalFrames()) +
+						   ", first frame after " + ofToString(sequence.getStats().timeToFirstFrameMicros / 1000) + "ms", 10, 20);
+	}
 }
 
 //--------------------------------------------------------------
@@ -42,33 +42,71 @@
  */
 
 #include "ofxImageSequence.h"
+#include <sys/stat.h>
+#include <fstream>
+#include <condition_variable>
+#ifdef TARGET_LINUX
+#include <sys/inotify.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OFX_IMAGE_SEQUENCE_USE_SSE2
+#endif
+
+//how often the folder is listed when inotify is not available
+#define OFX_IMAGE_SEQUENCE_WATCH_POLL_MILLIS 1000
+//edge length in pixels of the tiles regions of interest are decoded and cached in
+#define OFX_IMAGE_SEQUENCE_TILE_SIZE 512
+//how often available memory is checked against the watermark
+#define OFX_IMAGE_SEQUENCE_MEMORY_POLL_MILLIS 1000
+
+static ofxImageSequenceFileStamp getFileStamp(const string& path)
+{
+	ofxImageSequenceFileStamp stamp = {0, 0, 0};
+	struct stat info;
+	if(stat(ofToDataPath(path).c_str(), &info) != 0){
+		return stamp;
+	}
+	stamp.modifiedSeconds = info.st_mtime;
+	#if defined(TARGET_LINUX) || defined(TARGET_ANDROID)
+	stamp.modifiedNanoseconds = info.st_mtim.tv_nsec;
+	#elif defined(TARGET_OSX) || defined(TARGET_OF_IOS)
+	stamp.modifiedNanoseconds = info.st_mtimespec.tv_nsec;
+	#endif
+	stamp.size = info.st_size;
+	return stamp;
+}
 
-class ofxImageSequenceLoader : public ofThread
+template<typename PixelType>
+class ofxImageSequenceLoader_ : public ofThread
 {
   public:
 
-	bool loading;
-	bool cancelLoading;
-	ofxImageSequence& sequenceRef;
+	atomic<bool> loading;
+	atomic<bool> cancelLoading;
+	ofxImageSequence_<PixelType>& sequenceRef;
 	
-	ofxImageSequenceLoader(ofxImageSequence* seq)
-	: sequenceRef(*seq)
-	, loading(true)
+	ofxImageSequenceLoader_(ofxImageSequence_<PixelType>* seq)
+	: loading(true)
 	, cancelLoading(false)
+	, sequenceRef(*seq)
 	{
 		startThread(true);
 	}
 	
-	~ofxImageSequenceLoader(){
+	~ofxImageSequenceLoader_(){
         cancel();
     }
 	
     void cancel(){
 		if(loading){
-			ofRemoveListener(ofEvents().update, this, &ofxImageSequenceLoader::updateThreadedLoad);
-            lock();
+			ofRemoveListener(ofEvents().update, this, &ofxImageSequenceLoader_<PixelType>::updateThreadedLoad);
 			cancelLoading = true;
-            unlock();
             loading = false;
 			waitForThread(true);
 		}
@@ -76,431 +114,2509 @@ class ofxImageSequenceLoader : public ofThread
     
 	void threadedFunction(){
 	
-		ofAddListener(ofEvents().update, this, &ofxImageSequenceLoader::updateThreadedLoad);
+		ofAddListener(ofEvents().update, this, &ofxImageSequenceLoader_<PixelType>::updateThreadedLoad);
+
+		if(!sequenceRef.preloadAllFilenames()){
+			loading = false;
+			return;
+		}
+
+		if(cancelLoading){
+			loading = false;
+			cancelLoading = false;
+			return;
+		}
+	
+		sequenceRef.preloadAllFrames();
+	
+		loading = false;
+	}
+
+	void updateThreadedLoad(ofEventArgs& args){
+		//the sequence becomes drawable as soon as the first frame is decoded
+		if(!sequenceRef.isLoaded() && sequenceRef.getNumFramesReady() > 0){
+			sequenceRef.completeLoading();
+		}
+
+		if(loading){
+			return;
+		}
+		ofRemoveListener(ofEvents().update, this, &ofxImageSequenceLoader_<PixelType>::updateThreadedLoad);
+
+		if(!sequenceRef.isLoaded() && sequenceRef.getTotalFrames() > 0){
+			sequenceRef.completeLoading();
+		}
+	}
+
+};
+
+//the 64 bit intrinsics only exist on x64, 32 bit Windows builds work on the two halves
+static inline int countBits(uint64_t word)
+{
+	#if defined(_MSC_VER) && defined(_M_X64)
+	return (int)__popcnt64(word);
+	#elif defined(_MSC_VER)
+	return (int)(__popcnt((unsigned int)word) + __popcnt((unsigned int)(word >> 32)));
+	#else
+	return __builtin_popcountll(word);
+	#endif
+}
+
+static inline int lowestBit(uint64_t word)
+{
+	#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return (int)index;
+	#elif defined(_MSC_VER)
+	unsigned long index;
+	if(_BitScanForward(&index, (unsigned long)word)){
+		return (int)index;
+	}
+	_BitScanForward(&index, (unsigned long)(word >> 32));
+	return (int)index + 32;
+	#else
+	return __builtin_ctzll(word);
+	#endif
+}
+
+static inline int highestBit(uint64_t word)
+{
+	#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanReverse64(&index, word);
+	return (int)index;
+	#elif defined(_MSC_VER)
+	unsigned long index;
+	if(_BitScanReverse(&index, (unsigned long)(word >> 32))){
+		return (int)index + 32;
+	}
+	_BitScanReverse(&index, (unsigned long)word);
+	return (int)index;
+	#else
+	return 63 - __builtin_clzll(word);
+	#endif
+}
+
+ofxImageSequenceBitmap::ofxImageSequenceBitmap()
+{
+	numBits = 0;
+	numWords = 0;
+}
+
+void ofxImageSequenceBitmap::allocate(int newNumBits)
+{
+	numBits = newNumBits;
+	numWords = (numBits + 63) / 64;
+	words.reset(numWords > 0 ? new atomic<uint64_t>[numWords] : NULL);
+	clear();
+}
+
+void ofxImageSequenceBitmap::clear()
+{
+	for(int i = 0; i < numWords; i++){
+		words[i].store(0, memory_order_relaxed);
+	}
+	atomic_thread_fence(memory_order_release);
+}
+
+int ofxImageSequenceBitmap::size() const
+{
+	return numBits;
+}
+
+bool ofxImageSequenceBitmap::get(int index) const
+{
+	return (words[index / 64].load(memory_order_acquire) >> (index % 64)) & 1;
+}
+
+bool ofxImageSequenceBitmap::set(int index)
+{
+	uint64_t bit = uint64_t(1) << (index % 64);
+	return (words[index / 64].fetch_or(bit, memory_order_acq_rel) & bit) == 0;
+}
+
+bool ofxImageSequenceBitmap::reset(int index)
+{
+	uint64_t bit = uint64_t(1) << (index % 64);
+	return (words[index / 64].fetch_and(~bit, memory_order_acq_rel) & bit) != 0;
+}
+
+int ofxImageSequenceBitmap::count() const
+{
+	int total = 0;
+	for(int i = 0; i < numWords; i++){
+		total += countBits(words[i].load(memory_order_acquire));
+	}
+	return total;
+}
+
+int ofxImageSequenceBitmap::findPrevious(int from, bool value) const
+{
+	if(from < 0 || from >= numBits){
+		return -1;
+	}
+
+	int wordIndex = from / 64;
+	uint64_t word = words[wordIndex].load(memory_order_acquire);
+	if(!value){
+		word = ~word;
+	}
+	word &= ~uint64_t(0) >> (63 - from % 64);
+	while(word == 0){
+		if(--wordIndex < 0){
+			return -1;
+		}
+		word = words[wordIndex].load(memory_order_acquire);
+		if(!value){
+			word = ~word;
+		}
+	}
+	return wordIndex * 64 + highestBit(word);
+}
+
+int ofxImageSequenceBitmap::findNext(int from, bool value) const
+{
+	if(from < 0 || from >= numBits){
+		return -1;
+	}
+
+	//mask off the bits below from in the first word, then skip whole words
+	int wordIndex = from / 64;
+	uint64_t word = words[wordIndex].load(memory_order_acquire);
+	if(!value){
+		word = ~word;
+	}
+	word &= ~uint64_t(0) << (from % 64);
+	while(word == 0){
+		if(++wordIndex >= numWords){
+			return -1;
+		}
+		word = words[wordIndex].load(memory_order_acquire);
+		if(!value){
+			word = ~word;
+		}
+	}
+
+	int index = wordIndex * 64 + lowestBit(word);
+	return index < numBits ? index : -1;
+}
+
+//decodes the frame most recently asked for in the background, for adaptive quality
+template<typename PixelType>
+class ofxImageSequenceDecodeWorker_ : public ofThread
+{
+  public:
+
+	atomic<int> requestedFrame;
+	ofxImageSequence_<PixelType>& sequenceRef;
+	std::mutex requestMutex;
+	condition_variable requestChanged;
+
+	ofxImageSequenceDecodeWorker_(ofxImageSequence_<PixelType>* seq)
+	: requestedFrame(-1)
+	, sequenceRef(*seq)
+	{
+		startThread(true);
+	}
+
+	~ofxImageSequenceDecodeWorker_(){
+		stopThread();
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+			requestChanged.notify_all();
+		}
+		waitForThread(false);
+	}
+
+	void request(int frame){
+		std::lock_guard<std::mutex> lock(requestMutex);
+		requestedFrame = frame;
+		requestChanged.notify_one();
+	}
+
+	void threadedFunction(){
+		ofBuffer buffer;
+		while(isThreadRunning()){
+			//requests that were overtaken by a newer one before the worker got to them are dropped
+			int frame = requestedFrame.exchange(-1);
+			if(frame < 0){
+				std::unique_lock<std::mutex> lock(requestMutex);
+				while(requestedFrame < 0 && isThreadRunning()){
+					requestChanged.wait(lock);
+				}
+				continue;
+			}
+			sequenceRef.decodeFrame(frame, buffer);
+		}
+	}
+};
+
+static void updateAverage(atomic<uint64_t>& average, uint64_t sample)
+{
+	uint64_t previous = average;
+	average = previous == 0 ? sample : (previous * 7 + sample) / 8;
+}
+
+//index of the first pixel in [from, to) of an RGBA row with an alpha above zero, -1 if there is none
+template<typename PixelType>
+static int findFirstAlpha(const PixelType* row, int from, int to)
+{
+	for(int x = from; x < to; x++){
+		if(row[x * 4 + 3] > 0){
+			return x;
+		}
+	}
+	return -1;
+}
+
+template<typename PixelType>
+static int findLastAlpha(const PixelType* row, int from, int to)
+{
+	for(int x = to - 1; x >= from; x--){
+		if(row[x * 4 + 3] > 0){
+			return x;
+		}
+	}
+	return -1;
+}
+
+#ifdef OFX_IMAGE_SEQUENCE_USE_SSE2
+//8 bit rows are scanned four pixels per 16 byte load, with four loads merged before testing.
+//mostly transparent rows are skipped at close to memory speed
+static inline bool hasAlpha(const unsigned char* pixels, int count)
+{
+	const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+	__m128i any = _mm_setzero_si128();
+	for(int i = 0; i < count; i += 4){
+		any = _mm_or_si128(any, _mm_loadu_si128((const __m128i*)(pixels + i * 4)));
+	}
+	any = _mm_and_si128(any, alphaMask);
+	return _mm_movemask_epi8(_mm_cmpeq_epi32(any, _mm_setzero_si128())) != 0xffff;
+}
+
+static int findFirstAlpha(const unsigned char* row, int from, int to)
+{
+	int x = from;
+	for(; x + 16 <= to; x += 16){
+		if(hasAlpha(row + x * 4, 16)){
+			break;
+		}
+	}
+	for(; x + 4 <= to; x += 4){
+		if(hasAlpha(row + x * 4, 4)){
+			break;
+		}
+	}
+	return findFirstAlpha<unsigned char>(row, x, to);
+}
+
+static int findLastAlpha(const unsigned char* row, int from, int to)
+{
+	int x = to;
+	for(; x - 16 >= from; x -= 16){
+		if(hasAlpha(row + (x - 16) * 4, 16)){
+			break;
+		}
+	}
+	for(; x - 4 >= from; x -= 4){
+		if(hasAlpha(row + (x - 4) * 4, 4)){
+			break;
+		}
+	}
+	return findLastAlpha<unsigned char>(row, from, x);
+}
+#endif
+
+//tight bounds of the pixels of an RGBA frame with an alpha above zero, false if there are none.
+//after the first and last rows with any alpha are found, rows in between only scan outside the
+//columns already known to be inside the bounds
+template<typename PixelType>
+static bool findAlphaBounds(const ofPixels_<PixelType>& pixels, ofRectangle& bounds)
+{
+	int width = pixels.getWidth(), height = pixels.getHeight();
+	const PixelType* data = pixels.getData();
+	int top = 0;
+	while(top < height && findFirstAlpha(data + top * width * 4, 0, width) < 0){
+		top++;
+	}
+	if(top == height){
+		return false;
+	}
+	int bottom = height - 1;
+	while(findFirstAlpha(data + bottom * width * 4, 0, width) < 0){
+		bottom--;
+	}
+
+	int left = width, right = -1;
+	for(int y = top; y <= bottom; y++){
+		const PixelType* row = data + y * width * 4;
+		int x = left > 0 ? findFirstAlpha(row, 0, left) : -1;
+		if(x >= 0){
+			left = x;
+		}
+		x = right < width - 1 ? findLastAlpha(row, right + 1, width) : -1;
+		if(x >= 0){
+			right = x;
+		}
+	}
+	bounds.set(left, top, right - left + 1, bottom - top + 1);
+	return true;
+}
+
+#ifdef TARGET_LINUX
+static uint64_t readCgroupValue(const string& path)
+{
+	ifstream file(path.c_str());
+	uint64_t value = 0;
+	file >> value;			//"max" reads as no value
+	return value;
+}
+#endif
+
+//the memory limit and how much of it is left, from the cgroup v2 the process runs in when that has a limit
+//lower than the system's memory, otherwise from /proc/meminfo. false where neither can be read
+static bool readMemoryInfo(uint64_t& limit, uint64_t& available)
+{
+	#ifdef TARGET_LINUX
+	ifstream meminfo("/proc/meminfo");
+	string key, unit;
+	uint64_t value, total = 0, free = 0;
+	while(meminfo >> key >> value){
+		getline(meminfo, unit);
+		if(key == "MemTotal:"){
+			total = value * 1024;
+		}
+		else if(key == "MemAvailable:"){
+			free = value * 1024;
+		}
+	}
+	if(total == 0){
+		return false;
+	}
+	limit = total;
+	available = free;
+
+	ifstream cgroup("/proc/self/cgroup");
+	string line;
+	while(getline(cgroup, line)){
+		if(line.compare(0, 3, "0::") != 0){
+			continue;
+		}
+		string folder = "/sys/fs/cgroup" + line.substr(3);
+		uint64_t cgroupLimit = readCgroupValue(folder + "/memory.max");
+		if(cgroupLimit == 0 || cgroupLimit >= total){
+			break;
+		}
+		//page cache the kernel can drop doesn't count against what is left
+		uint64_t usage = readCgroupValue(folder + "/memory.current");
+		ifstream stat((folder + "/memory.stat").c_str());
+		while(stat >> key >> value){
+			if(key == "inactive_file"){
+				usage -= MIN(usage, value);
+				break;
+			}
+		}
+		limit = cgroupLimit;
+		available = MIN(available, cgroupLimit > usage ? cgroupLimit - usage : 0);
+		break;
+	}
+	return true;
+	#else
+	return false;
+	#endif
+}
+
+template<typename PixelType>
+ofxImageSequence_<PixelType>::ofxImageSequence_()
+{
+	loaded = false;
+	useThread = false;
+	frameRate = 30.0f;
+	lastFrameLoaded = -1;
+	currentFrame = 0;
+	maxFrames = 0;
+	threadLoader = NULL;
+	numFramesReady = 0;
+	numFramesFailed = 0;
+	decodedBytes = 0;
+	totalFrames = 0;
+	watchFolder = false;
+	watchingFolder = false;
+	folderChanged = false;
+	filesWritten = false;
+	inotifyDescriptor = -1;
+	watchDescriptor = -1;
+	lastFolderScanTime = 0;
+	loadStartTime = 0;
+	patternStart = 0;
+	patternDigits = 0;
+	readAheadFrames = 4;
+	useRegionOfInterest = false;
+	trimAlpha = false;
+	tileCacheSize = 256 * 1024 * 1024;
+	tileClock = 0;
+	tileCacheBytes = 0;
+	lastRegionFrame = -1;
+	adaptiveQuality = false;
+	reducedQuality = false;
+	proxyUnsupported = false;
+	proxyReduction = 4;
+	pendingFrame = -1;
+	decodeWorker = NULL;
+	sharingFrames = false;
+	sharedFramesSeen = 0;
+	memoryBudget = 0;
+	defaultMemoryBudget = 0;
+	automaticMemoryBudget = true;
+	memoryWatermark = 0.1;
+	monitoringMemory = false;
+	underMemoryPressure = false;
+	lastMemoryCheckTime = 0;
+	frameListLocks = 0;
+	resetStats();
+
+	defaultDecoder = shared_ptr<ofxImageSequenceDecoder>(new ofxImageSequenceFreeImageDecoder());
+	shared_ptr<ofxImageSequenceDecoder> ppmDecoder(new ofxImageSequencePPMDecoder());
+	setDecoder("ppm", ppmDecoder);
+	setDecoder("pgm", ppmDecoder);
+	setDecoder("pnm", ppmDecoder);
+	setDecoder("qoi", shared_ptr<ofxImageSequenceDecoder>(new ofxImageSequenceQOIDecoder()));
+	#ifdef OFX_IMAGE_SEQUENCE_USE_TURBOJPEG
+	shared_ptr<ofxImageSequenceDecoder> jpegDecoder(new ofxImageSequenceTurboJpegDecoder());
+	setDecoder("jpg", jpegDecoder);
+	setDecoder("jpeg", jpegDecoder);
+	#endif
+	#ifdef OFX_IMAGE_SEQUENCE_USE_SPNG
+	setDecoder("png", shared_ptr<ofxImageSequenceDecoder>(new ofxImageSequenceSpngDecoder()));
+	#endif
+	ofAddListener(ofEvents().update, this, &ofxImageSequence_<PixelType>::updateCurrentFrame);
+}
+
+template<typename PixelType>
+ofxImageSequence_<PixelType>::~ofxImageSequence_()
+{
+	ofRemoveListener(ofEvents().update, this, &ofxImageSequence_<PixelType>::updateCurrentFrame);
+	enableAdaptiveQuality(false);
+	unloadSequence();
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::loadSequence(string prefix, string filetype,  int startDigit, int endDigit)
+{
+	return loadSequence(prefix, filetype, startDigit, endDigit, 0);
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::loadSequence(string prefix, string filetype,  int startDigit, int endDigit, int numDigits)
+{
+	if(isFrameListLocked("ofxImageSequence::loadSequence")){
+		return false;
+	}
+	unloadSequence();
+	loadStartTime = ofGetElapsedTimeMicros();
+	startMemoryMonitor();
+
+	int numFiles = endDigit - startDigit+1;
+	if(numFiles <= 0 ){
+		ofLogError("ofxImageSequence::loadSequence") << "No image files found.";
+		return false;
+	}
+
+	//file names are built from the pattern when a frame is read, nothing is stored per frame up front
+	patternPrefix = prefix;
+	patternSuffix = "." + filetype;
+	patternStart = startDigit;
+	patternDigits = numDigits;
+	frameSlots.assign(numFiles, -1);
+	resetFrameStates();
+	
+	loaded = true;
+	
+	lastFrameLoaded = -1;
+	loadFrame(0);
+	
+	updateSize();
+	return true;
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::loadSequence(string _folder)
+{
+	if(isFrameListLocked("ofxImageSequence::loadSequence")){
+		return false;
+	}
+	unloadSequence();
+	loadStartTime = ofGetElapsedTimeMicros();
+	startMemoryMonitor();
+
+	folderToLoad = _folder;
+
+	if(useThread){
+		threadLoader = new ofxImageSequenceLoader_<PixelType>(this);
+		return true;
+	}
+
+	if(preloadAllFilenames()){
+		completeLoading();
+		return true;
+	}
+	
+	return false;
+
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::completeLoading()
+{
+
+	if(totalFrames == 0){
+		ofLogError("ofxImageSequence::completeLoading") << "load failed with empty image sequence";
+		return;
+	}
+
+	loaded = true;	
+	lastFrameLoaded = -1;
+	loadFrame(0);
+
+	//during a threaded load frame 0 may still be decoding, size the sequence from whichever frame is shown
+	updateSize();
+
+	if(watchFolder && folderToLoad != ""){
+		startFolderWatch();
+	}
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::preloadAllFilenames()
+{
+	vector<string> paths;
+	if(ofxImageSequenceArchive::isArchive(folderToLoad)){
+		if(!listArchive(paths)){
+			return false;
+		}
+	}
+	else if(!listFolder(paths)){
+		return false;
+	}
+
+    if(paths.size() == 0) {
+		ofLogError("ofxImageSequence::loadSequence") << "No image files found in " << folderToLoad;
+		return false;
+	}
+
+	ofxImageSequenceFileStamp unknown = {0, 0, 0};
+	fileStamps.resize(paths.size());
+	for(int i = 0; i < paths.size(); i++) {
+		fileStamps[i] = watchFolder && !archive.isOpen() ? getFileStamp(paths[i]) : unknown;
+    }
+	filenames.swap(paths);
+	frameSlots.assign(filenames.size(), -1);
+	resetFrameStates();
+	return true;
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::listFolder(vector<string>& paths)
+{
+    ofDirectory dir;
+	if(extension != ""){
+		dir.allowExt(extension);
+	}
+	
+	if(!ofFile(folderToLoad).exists()){
+		ofLogError("ofxImageSequence::loadSequence") << "Could not find folder " << folderToLoad;
+		return false;
+	}
+
+	int numFiles;
+	if(maxFrames > 0){
+		numFiles = MIN(dir.listDir(folderToLoad), maxFrames);
+	}
+	else{	
+		numFiles = dir.listDir(folderToLoad);
+	}
+
+    // read the directory for the images
+	#ifdef TARGET_LINUX
+	dir.sort();
+	#endif
+
+	paths.clear();
+	for(int i = 0; i < numFiles; i++) {
+        paths.push_back(dir.getPath(i));
+    }
+	return true;
+}
+
+//frames are the archive members with the sequence's extension, in name order like a sorted folder
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::listArchive(vector<string>& paths)
+{
+	if(!archive.open(folderToLoad)){
+		return false;
+	}
+
+	vector<pair<string, int> > frames;
+	frames.reserve(archive.getNumMembers());
+	for(int i = 0; i < archive.getNumMembers(); i++){
+		string name = archive.getMemberName(i);
+		string filename = ofFilePath::getFileName(name);
+		if(filename == "" || filename[0] == '.' || name.compare(0, 9, "__MACOSX/") == 0){
+			continue;
+		}
+		if(extension != "" && ofToLower(ofFilePath::getFileExt(name)) != ofToLower(extension)){
+			continue;
+		}
+		frames.push_back(make_pair(name, i));
+	}
+	sort(frames.begin(), frames.end());
+
+	if(maxFrames > 0 && frames.size() > maxFrames){
+		frames.resize(maxFrames);
+	}
+
+	paths.resize(frames.size());
+	archiveMembers.resize(frames.size());
+	for(int i = 0; i < frames.size(); i++){
+		paths[i] = frames[i].first;
+		archiveMembers[i] = frames[i].second;
+	}
+	return true;
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::rescanFolder()
+{
+	if(folderToLoad == "" || isLoading() || archive.isOpen() || isFrameListLocked("ofxImageSequence::rescanFolder")){
+		return false;
+	}
+
+	lastFolderScanTime = ofGetElapsedTimeMillis();
+	folderChanged = false;
+	changedFiles.clear();
+	//a frame read while its file was half written fails, and the finished file can still have the same
+	//stamp on filesystems with coarse timestamps, so after writes every failed frame is tried again
+	bool retryFailed = filesWritten;
+	filesWritten = false;
+
+	vector<string> paths;
+	if(!listFolder(paths)){
+		return false;
+	}
+	vector<ofxImageSequenceFileStamp> stamps(paths.size());
+	for(int i = 0; i < paths.size(); i++){
+		stamps[i] = getFileStamp(paths[i]);
+	}
+	return replaceFrameList(paths, stamps, set<string>(), retryFailed);
+}
+
+//the order ofDirectory::sort lists a folder in: numerically for names that are plain numbers, by path otherwise
+static bool isListedBefore(const string& a, const string& b)
+{
+	string aName = ofFilePath::getBaseName(a), bName = ofFilePath::getBaseName(b);
+	int aNumber = ofToInt(aName), bNumber = ofToInt(bName);
+	if(ofToString(aNumber) == aName && ofToString(bNumber) == bName){
+		return aNumber < bNumber;
+	}
+	return a < b;
+}
+
+//applies the files inotify reported to the frame list without listing the folder. written files are added
+//or decoded again and files that are gone are removed, only those files are looked at
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::updateChangedFiles()
+{
+	if(folderToLoad == "" || isLoading() || archive.isOpen() || isFrameListLocked("ofxImageSequence::updateChangedFiles")){
+		return false;
+	}
+	//which files make the cut depends on the whole listing
+	if(maxFrames > 0){
+		return rescanFolder();
+	}
+
+	set<string> names;
+	names.swap(changedFiles);
+	vector<string> paths = filenames;
+	vector<ofxImageSequenceFileStamp> stamps = fileStamps;
+	set<string> written;
+	string folder = ofFilePath::getPathForDirectory(folderToLoad);
+	for(set<string>::iterator name = names.begin(); name != names.end(); name++){
+		string path = folder + *name;
+		vector<string>::iterator position = lower_bound(paths.begin(), paths.end(), path, isListedBefore);
+		int index = position - paths.begin();
+		bool listed = position != paths.end() && *position == path;
+
+		//the events of a batch can cancel out, the file as it is now decides
+		ofxImageSequenceFileStamp stamp = getFileStamp(path);
+		bool isFrame = stamp.modifiedSeconds != 0 && (*name)[0] != '.' &&
+			(extension == "" || ofToLower(ofFilePath::getFileExt(*name)) == ofToLower(extension));
+		if(!isFrame){
+			if(listed){
+				paths.erase(position);
+				stamps.erase(stamps.begin() + index);
+			}
+			continue;
+		}
+		if(listed){
+			stamps[index] = stamp;
+		}
+		else{
+			paths.insert(position, path);
+			stamps.insert(stamps.begin() + index, stamp);
+		}
+		written.insert(path);
+	}
+	return replaceFrameList(paths, stamps, written, false);
+}
+
+//moves the frames over to a new list of files, keeping the decoded ones whose file is still listed with the
+//same stamp and wasn't written since. frames whose file failed stay failed unless retryFailed is set
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::replaceFrameList(vector<string>& paths, vector<ofxImageSequenceFileStamp>& stamps, const set<string>& written, bool retryFailed)
+{
+	stopDecodeWorker();
+	if(sharedFrames.isWriter()){
+		ofLogNotice("ofxImageSequence::rescanFolder") << "Frames are changing, stopped sharing them";
+		stopSharingFrames();
+	}
+
+	map<string, int> previousIndex;
+	for(int i = 0; i < filenames.size(); i++){
+		previousIndex[filenames[i]] = i;
+	}
+	string currentPath = currentFrame < filenames.size() ? filenames[currentFrame] : "";
+
+	vector<int> newFrameSlots(paths.size(), -1);
+	vector<bool> newLoadFailed(paths.size(), false);
+	int newCurrentFrame = -1;
+	int kept = 0, added = 0, changed = 0, retried = 0;
+
+	//decoded frames are moved over untouched unless their file was modified since it was listed
+	for(int i = 0; i < paths.size(); i++){
+		map<string, int>::iterator previous = previousIndex.find(paths[i]);
+		if(previous == previousIndex.end()){
+			added++;
+		}
+		else if(fileStamps[previous->second] != stamps[i] || written.count(paths[i]) > 0){
+			changed++;
+		}
+		else{
+			newFrameSlots[i] = frameSlots[previous->second];
+			frameSlots[previous->second] = -1;
+			if(failedFrames.get(previous->second)){
+				newLoadFailed[i] = !retryFailed;
+				retried += retryFailed ? 1 : 0;
+			}
+			kept++;
+		}
+		if(paths[i] == currentPath){
+			newCurrentFrame = i;
+		}
+	}
+
+	int removed = filenames.size() - kept - changed;
+	if(added == 0 && changed == 0 && removed == 0 && retried == 0){
+		return true;
+	}
+
+	ofLogNotice("ofxImageSequence::rescanFolder") << folderToLoad << ": " << added << " frames added, " << changed << " changed, " << removed << " removed";
+
+	//changed and removed frames free their pixels, their slots go back to the pool
+	for(int i = 0; i < frameSlots.size(); i++){
+		if(frameSlots[i] >= 0){
+			releaseSlot(frameSlots[i]);
+		}
+	}
+
+	frameSlots.swap(newFrameSlots);
+	filenames.swap(paths);
+	fileStamps.swap(stamps);
+	lastFrameLoaded = -1;
+	//tiles are cached by frame index, which may have shifted
+	clearTileCache();
+
+	resetFrameStates();
+	for(int i = 0; i < frameSlots.size(); i++){
+		if(frameSlots[i] >= 0){
+			claimedFrames.set(i);
+			readyFrames.set(i);
+			numFramesReady++;
+			decodedBytes += getFramePixels(i).size() * sizeof(PixelType);
+		}
+		else if(newLoadFailed[i]){
+			claimedFrames.set(i);
+			failedFrames.set(i);
+			numFramesFailed++;
+		}
+	}
+
+	if(totalFrames == 0){
+		loaded = false;
+		width = 0;
+		height = 0;
+		currentFrame = 0;
+		return true;
+	}
+
+	if(!loaded){
+		currentFrame = 0;
+		completeLoading();
+		return true;
+	}
+
+	currentFrame = newCurrentFrame >= 0 ? newCurrentFrame : MIN(currentFrame, totalFrames-1);
+	loadFrame(currentFrame);
+	return true;
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::startFolderWatch()
+{
+	if(watchingFolder){
+		return;
+	}
+
+	if(archive.isOpen()){
+		ofLogWarning("ofxImageSequence::enableFolderWatch") << "Archives can't be watched: " << folderToLoad;
+		return;
+	}
+
+	for(int i = 0; i < fileStamps.size(); i++){
+		if(fileStamps[i].modifiedSeconds == 0){
+			fileStamps[i] = getFileStamp(filenames[i]);
+		}
+	}
+
+	#ifdef TARGET_LINUX
+	inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(inotifyDescriptor >= 0){
+		//IN_CLOSE_WRITE rather than IN_MODIFY so frames still being written are not picked up half way
+		watchDescriptor = inotify_add_watch(inotifyDescriptor, ofToDataPath(folderToLoad).c_str(),
+											IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+		if(watchDescriptor < 0){
+			close(inotifyDescriptor);
+			inotifyDescriptor = -1;
+		}
+	}
+	if(inotifyDescriptor < 0){
+		ofLogWarning("ofxImageSequence::enableFolderWatch") << "inotify unavailable for " << folderToLoad << ", polling instead";
+	}
+	#endif
+
+	//catch anything that arrived between listing the folder and starting the watch
+	folderChanged = true;
+	lastFolderScanTime = ofGetElapsedTimeMillis();
+	ofAddListener(ofEvents().update, this, &ofxImageSequence_<PixelType>::updateFolderWatch);
+	watchingFolder = true;
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::stopFolderWatch()
+{
+	if(!watchingFolder){
+		return;
+	}
+
+	ofRemoveListener(ofEvents().update, this, &ofxImageSequence_<PixelType>::updateFolderWatch);
+	#ifdef TARGET_LINUX
+	if(inotifyDescriptor >= 0){
+		close(inotifyDescriptor);
+	}
+	#endif
+	inotifyDescriptor = -1;
+	watchDescriptor = -1;
+	folderChanged = false;
+	filesWritten = false;
+	changedFiles.clear();
+	watchingFolder = false;
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::updateFolderWatch(ofEventArgs& args)
+{
+	#ifdef TARGET_LINUX
+	if(inotifyDescriptor >= 0){
+		//the events name the files that changed, only when the queue overflowed and events were lost
+		//is the whole folder listed again
+		char events[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+		ssize_t length;
+		while((length = read(inotifyDescriptor, events, sizeof(events))) > 0){
+			for(char* event = events; event < events + length; event += sizeof(struct inotify_event) + ((struct inotify_event*)event)->len){
+				struct inotify_event* info = (struct inotify_event*)event;
+				if(info->mask & IN_Q_OVERFLOW){
+					folderChanged = true;
+				}
+				else if(info->len > 0 && !(info->mask & IN_ISDIR)){
+					changedFiles.insert(info->name);
+				}
+				if(info->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)){
+					filesWritten = true;
+				}
+			}
+		}
+	}
+	else
+	#endif
+	if(ofGetElapsedTimeMillis() - lastFolderScanTime >= OFX_IMAGE_SEQUENCE_WATCH_POLL_MILLIS){
+		folderChanged = true;
+	}
+
+	//frames stay as they are while a group or an exporter decodes them, the change is picked up after
+	if(frameListLocks == 0){
+		if(folderChanged){
+			rescanFolder();
+		}
+		else if(changedFiles.size() > 0){
+			updateChangedFiles();
+		}
+	}
+}
+
+//set to limit the number of frames. negative means no limit
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setMaxFrames(int newMaxFrames)
+{
+	maxFrames = MAX(newMaxFrames, 0);
+	if(loaded){
+		ofLogError("ofxImageSequence::setMaxFrames") << "Max frames must be called before load";
+	}
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setExtension(string ext)
+{
+	extension = ext;
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setDecoder(string ext, shared_ptr<ofxImageSequenceDecoder> decoder)
+{
+	if(isLoading()){
+		ofLogError("ofxImageSequence::setDecoder") << "Decoders can't be changed while loading";
+		return;
+	}
+	if(decoder){
+		decoders[ofToLower(ext)] = decoder;
+	}
+	else{
+		decoders.erase(ofToLower(ext));
+	}
+}
+
+template<typename PixelType>
+shared_ptr<ofxImageSequenceDecoder> ofxImageSequence_<PixelType>::getDecoder(string ext) const
+{
+	map<string, shared_ptr<ofxImageSequenceDecoder> >::const_iterator decoder = decoders.find(ofToLower(ext));
+	if(decoder != decoders.end()){
+		return decoder->second;
+	}
+	return defaultDecoder;
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::enableFolderWatch(bool enable)
+{
+	watchFolder = enable;
+	if(!watchFolder){
+		stopFolderWatch();
+	}
+	else if(loaded && folderToLoad != ""){
+		startFolderWatch();
+	}
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::enableThreadedLoad(bool enable){
+
+	if(loaded){
+		ofLogError("ofxImageSequence::enableThreadedLoad") << "Need to enable threaded loading before calling load";
+	}
+	useThread = enable;
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::cancelLoad()
+{
+	if(useThread && threadLoader != NULL){
+        threadLoader->cancel();
+        
+		delete threadLoader;
+		threadLoader = NULL;
+	}
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setMinMagFilter(int newMinFilter, int newMagFilter)
+{
+	minFilter = newMinFilter;
+	magFilter = newMagFilter;
+	texture.setTextureMinMagFilter(minFilter, magFilter);
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::draw(float x, float y) const
+{
+	draw(x, y, width, height);
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::draw(float x, float y, float w, float h) const
+{
+	if(textureBounds.isEmpty() || width == 0 || height == 0){
+		return;
+	}
+	float scaleX = w / width;
+	float scaleY = h / height;
+	texture.draw(x + textureBounds.x * scaleX, y + textureBounds.y * scaleY, textureBounds.width * scaleX, textureBounds.height * scaleY);
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::preloadAllFrames()
+{
+	if(totalFrames == 0){
+		ofLogError("ofxImageSequence::loadFrame") << "Calling preloadAllFrames on unitialized image sequence.";
+		return;
+	}
+	
+	ofBuffer buffer;
+	adviseFrames(0, readAheadFrames);
+
+	for(int i = 0; i < totalFrames; i++){
+		//threaded stuff
+		if(useThread){
+			if(threadLoader == NULL || threadLoader->cancelLoading){
+				return;
+			}
+
+			ofSleepMillis(15);
+		}
+		uint64_t budget = memoryBudget;
+		if(budget > 0 && decodedBytes >= budget){
+			ofLogNotice("ofxImageSequence::preloadAllFrames") << "Memory budget of " << budget / (1024 * 1024) << "MB reached after "
+				<< numFramesReady << " frames, the rest load as they are shown";
+			return;
+		}
+		if(i + readAheadFrames < totalFrames){
+			adviseFrames(i + readAheadFrames, 1);
+		}
+		decodeFrame(i, buffer);
+	}
+}
+
+//decodes a frame unless another thread already claimed it, safe to call from any thread
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::decodeFrame(int index, ofBuffer& buffer)
+{
+	if(!claimedFrames.set(index)){
+		return readyFrames.get(index);
+	}
+
+	uint64_t startTime = ofGetElapsedTimeMicros();
+	int slot = acquireSlot();
+	ofPixels_<PixelType>& pixels = getSlotPixels(slot);
+	if(!loadFramePixels(index, pixels, buffer)){
+		releaseSlot(slot);
+		failedFrames.set(index);
+		numFramesFailed++;
+		ofLogError("ofxImageSequence::loadFrame") << "Image failed to load: " << getFramePath(index);
+		return false;
+	}
+
+	ofRectangle bounds(0, 0, pixels.getWidth(), pixels.getHeight());
+	Slot& frameSlot = getSlot(slot);
+	frameSlot.frameWidth = bounds.width;
+	frameSlot.frameHeight = bounds.height;
+	//shared frames are used in place, trimming them would copy them
+	if(trimAlpha && !isAttachedToSharedFrames() && pixels.getNumChannels() == 4){
+		trimFrame(pixels, bounds);
+	}
+	frameSlot.bounds = bounds;
+
+	frameSlots[index] = slot;
+	decodedBytes += pixels.size() * sizeof(PixelType);
+	updateAverage(averageFrameMicros, ofGetElapsedTimeMicros() - startTime);
+	if(sharingFrames){
+		publishSharedFrame(index, pixels);
+	}
+
+	//setting the ready flag publishes the pixels to other threads
+	readyFrames.set(index);
+	if(numFramesReady++ == 0){
+		//only the load's first frame, not the first one after frames were evicted or decoded again
+		uint64_t none = 0;
+		timeToFirstFrameMicros.compare_exchange_strong(none, MAX(ofGetElapsedTimeMicros() - loadStartTime, 1));
+	}
+	return true;
+}
+
+//the frame's state is left alone, it is neither claimed nor kept
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::decodeFramePixels(int index, ofPixels_<PixelType>& pixels, ofBuffer& buffer)
+{
+	if(index < 0 || index >= totalFrames){
+		return false;
+	}
+	if(isAttachedToSharedFrames()){
+		//loadFramePixels points at the read only mapping, the caller gets a copy it can change
+		ofPixels_<PixelType> shared;
+		if(!loadFramePixels(index, shared, buffer)){
+			return false;
+		}
+		pixels = shared;
+		return true;
+	}
+	if(!loadFramePixels(index, pixels, buffer)){
+		ofLogError("ofxImageSequence::decodeFramePixels") << "Image failed to load: " << getFramePath(index);
+		return false;
+	}
+	return true;
+}
+
+template<typename PixelType>
+string ofxImageSequence_<PixelType>::getFramePath(int index) const
+{
+	if(isAttachedToSharedFrames()){
+		return sharedFrames.getName() + ":" + ofToString(index);
+	}
+	if(patternSuffix == ""){
+		return filenames[index];
+	}
+	char digits[32];
+	snprintf(digits, sizeof(digits), "%0*d", patternDigits, patternStart + index);
+	return patternPrefix + digits + patternSuffix;
+}
+
+//frame pixels live in a pool of slots so storage freed by one frame is decoded into by the next
+template<typename PixelType>
+int ofxImageSequence_<PixelType>::acquireSlot()
+{
+	ofScopedLock lock(slotMutex);
+	if(freeSlots.size() > 0){
+		int slot = freeSlots.back();
+		freeSlots.pop_back();
+		return slot;
+	}
+	slots.push_back(Slot());
+	return slots.size() - 1;
+}
+
+//pooled slots keep no pixels, decodedBytes only counts frames that are ready and the budget can't see the pool
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::releaseSlot(int slot)
+{
+	ofScopedLock lock(slotMutex);
+	slots[slot].pixels.clear();
+	freeSlots.push_back(slot);
+}
+
+//the deque never moves existing slots, the lock only guards against another thread growing it
+template<typename PixelType>
+typename ofxImageSequence_<PixelType>::Slot& ofxImageSequence_<PixelType>::getSlot(int slot)
+{
+	ofScopedLock lock(slotMutex);
+	return slots[slot];
+}
+
+template<typename PixelType>
+ofPixels_<PixelType>& ofxImageSequence_<PixelType>::getSlotPixels(int slot)
+{
+	return getSlot(slot).pixels;
+}
+
+template<typename PixelType>
+ofPixels_<PixelType>& ofxImageSequence_<PixelType>::getFramePixels(int index)
+{
+	return getSlotPixels(frameSlots[index]);
+}
+
+//the sequence is as big as its frames before trimming. a proxy may be shown before any frame is decoded
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::updateSize()
+{
+	if(lastFrameLoaded >= 0 && readyFrames.get(lastFrameLoaded)){
+		Slot& slot = getSlot(frameSlots[lastFrameLoaded]);
+		width = slot.frameWidth;
+		height = slot.frameHeight;
+	}
+}
+
+//bounds comes in as the whole frame and is set to the part that is kept
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::trimFrame(ofPixels_<PixelType>& pixels, ofRectangle& bounds)
+{
+	uint64_t frameBytes = pixels.size() * sizeof(PixelType);
+	if(!findAlphaBounds(pixels, bounds)){
+		bounds.set(0, 0, 0, 0);
+		pixels.clear();
+		trimmedBytes += frameBytes;
+		transparentFrames++;
+		return;
+	}
+	if(bounds.width == pixels.getWidth() && bounds.height == pixels.getHeight()){
+		return;
+	}
+
+	ofPixels_<PixelType> trimmed;
+	pixels.cropTo(trimmed, bounds.x, bounds.y, bounds.width, bounds.height);
+	pixels.swap(trimmed);
+	trimmedBytes += frameBytes - pixels.size() * sizeof(PixelType);
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::resetFrameStates()
+{
+	claimedFrames.allocate(frameSlots.size());
+	readyFrames.allocate(frameSlots.size());
+	failedFrames.allocate(frameSlots.size());
+	numFramesReady = 0;
+	numFramesFailed = 0;
+	decodedBytes = 0;
+	totalFrames = frameSlots.size();
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::isFrameReady(int index) const
+{
+	return index >= 0 && index < totalFrames && readyFrames.get(index);
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::isFrameFailed(int index) const
+{
+	return index >= 0 && index < totalFrames && failedFrames.get(index);
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::isFrameClaimed(int index) const
+{
+	return index >= 0 && index < totalFrames && claimedFrames.get(index);
+}
+
+template<typename PixelType>
+int ofxImageSequence_<PixelType>::getNumFramesReady() const
+{
+	return numFramesReady;
+}
+
+template<typename PixelType>
+int ofxImageSequence_<PixelType>::getNearestReadyFrame(int index) const
+{
+	if(index < 0 || index >= totalFrames){
+		return -1;
+	}
+
+	int next = readyFrames.findNext(index, true);
+	int previous = readyFrames.findPrevious(index, true);
+	if(next < 0){
+		return previous;
+	}
+	if(previous < 0 || next - index < index - previous){
+		return next;
+	}
+	return previous;
+}
+
+template<typename PixelType>
+vector<pair<int, int> > ofxImageSequence_<PixelType>::getReadyRanges() const
+{
+	vector<pair<int, int> > ranges;
+	if(totalFrames == 0){
+		return ranges;
+	}
+
+	int first = readyFrames.findNext(0, true);
+	while(first >= 0){
+		int end = readyFrames.findNext(first, false);
+		if(end < 0){
+			end = totalFrames;
+		}
+		ranges.push_back(make_pair(first, end - 1));
+		first = end < totalFrames ? readyFrames.findNext(end, true) : -1;
+	}
+	return ranges;
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::readFrame(int index, ofBuffer& buffer)
+{
+	uint64_t startTime = ofGetElapsedTimeMicros();
+
+	FILE* file = fopen(ofToDataPath(getFramePath(index)).c_str(), "rb");
+	if(file == NULL){
+		return false;
+	}
+	//read straight into the buffer, stdio buffering would only add a copy
+	setvbuf(file, NULL, _IONBF, 0);
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if(size <= 0){
+		fclose(file);
+		return false;
+	}
+
+	//allocate keeps the capacity from the previous frame, so the buffer is only grown, never reallocated per frame
+	buffer.allocate(size);
+	size_t numRead = fread(buffer.getData(), 1, size, file);
+	fclose(file);
+	if(numRead != size){
+		return false;
+	}
+
+	framesRead++;
+	bytesRead += size;
+	ioMicros += ofGetElapsedTimeMicros() - startTime;
+	return true;
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::readFrameData(int index, ofBuffer& buffer, const char*& data, size_t& size)
+{
+	if(archive.isOpen()){
+		//archive members decode straight from the mapping, reading happens as the decoder touches the pages
+		data = archive.getMemberData(archiveMembers[index]);
+		size = archive.getMemberSize(archiveMembers[index]);
+		if(data == NULL){
+			return false;
+		}
+		framesRead++;
+		bytesRead += size;
+	}
+	else{
+		if(!readFrame(index, buffer)){
+			return false;
+		}
+		data = buffer.getData();
+		size = buffer.size();
+	}
+	return true;
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::loadFramePixels(int index, ofPixels_<PixelType>& pixels, ofBuffer& buffer)
+{
+	if(isAttachedToSharedFrames()){
+		//shared frames are used in place, the mapping is read only and nothing writes to them
+		size_t frameWidth, frameHeight, channels;
+		const void* shared = sharedFrames.getFrame(index, frameWidth, frameHeight, channels);
+		if(shared == NULL){
+			return false;
+		}
+		pixels.setFromExternalPixels((PixelType*)shared, frameWidth, frameHeight, channels);
+		return true;
+	}
+
+	const char* data;
+	size_t size;
+	if(!readFrameData(index, buffer, data, size)){
+		return false;
+	}
+
+	uint64_t startTime = ofGetElapsedTimeMicros();
+	shared_ptr<ofxImageSequenceDecoder> decoder = getDecoder(ofFilePath::getFileExt(getFramePath(index)));
+	//frames from files hand over the buffer they were read into, archive members only have their mapping
+	bool fromBuffer = !archive.isOpen();
+	bool decoded = useRegionOfInterest ? decodeRegion(index, data, size, decoder, pixels) :
+				   fromBuffer ? decoder->decode(buffer, pixels) : decoder->decode(data, size, pixels);
+	if(!decoded && decoder != defaultDecoder){
+		//fast paths only cover the common variants of a format, FreeImage handles the rest
+		decoded = useRegionOfInterest ? decodeRegion(index, data, size, defaultDecoder, pixels) :
+				  fromBuffer ? defaultDecoder->decode(buffer, pixels) : defaultDecoder->decode(data, size, pixels);
+	}
+	framesDecoded++;
+	decodeMicros += ofGetElapsedTimeMicros() - startTime;
+	return decoded;
+}
+
+//asks the kernel to start reading the next frame files into the page cache so reads
+//overlap with decoding instead of each frame paying the full seek + read latency
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::adviseFrames(int fromIndex, int count)
+{
+	int numFrames = totalFrames;
+	if(archive.isOpen()){
+		for(int i = 0; i < MIN(count, numFrames); i++){
+			int index = (fromIndex + i) % numFrames;
+			if(!claimedFrames.get(index)){
+				archive.adviseMember(archiveMembers[index]);
+			}
+		}
+		return;
+	}
+
+	#ifdef TARGET_LINUX
+	for(int i = 0; i < MIN(count, numFrames); i++){
+		int index = (fromIndex + i) % numFrames;
+		if(claimedFrames.get(index)){
+			continue;
+		}
+		int fd = open(ofToDataPath(getFramePath(index)).c_str(), O_RDONLY);
+		if(fd < 0){
+			continue;
+		}
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		close(fd);
+	}
+	#endif
+}
+
+static uint64_t getTileKey(int index, int row, int column)
+{
+	return ((uint64_t)index << 32) | ((uint64_t)row << 16) | (uint64_t)column;
+}
+
+//regions are decoded in tiles on a fixed grid and cached, so a region that moves only decodes the
+//tiles it did not cover before. when the same frame is decoded again, as when panning a paused frame,
+//missing tiles are decoded with a margin of one tile around the region to have the next pan ready. during
+//playback every frame is new and the margin would only churn the cache. the lock only covers the cache, region decodes run in parallel and a tile
+//two of them decoded is kept from whichever inserts it first
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::decodeRegion(int index, const char* data, size_t size, shared_ptr<ofxImageSequenceDecoder> decoder, ofPixels_<PixelType>& pixels)
+{
+	const int tileSize = OFX_IMAGE_SEQUENCE_TILE_SIZE;
+	int left = regionOfInterest.x;
+	int top = regionOfInterest.y;
+	int right = regionOfInterest.getRight();
+	int bottom = regionOfInterest.getBottom();
+	int firstColumn = left / tileSize, lastColumn = (right - 1) / tileSize;
+	int firstRow = top / tileSize, lastRow = (bottom - 1) / tileSize;
+
+	ofScopedLock lock(tileMutex);
+	uint64_t firstUse = tileClock + 1;
+	int margin = index == lastRegionFrame ? 1 : 0;
+	lastRegionFrame = index;
+
+	//tiles evicted by another decode while this one was decoding unlocked are decoded again,
+	//without the margin this time
+	for(bool firstPass = true; ; firstPass = false, margin = 0){
+		//bounds of the tiles missing from the region and its margin
+		int missingLeft = INT_MAX, missingTop = INT_MAX, missingRight = -1, missingBottom = -1;
+		for(int row = MAX(firstRow - margin, 0); row <= lastRow + margin; row++){
+			for(int column = MAX(firstColumn - margin, 0); column <= lastColumn + margin; column++){
+				bool inRegion = row >= firstRow && row <= lastRow && column >= firstColumn && column <= lastColumn;
+				typename map<uint64_t, Tile>::iterator found = tiles.find(getTileKey(index, row, column));
+				if(found != tiles.end()){
+					if(inRegion){
+						found->second.lastUsed = ++tileClock;
+						tilesReused += firstPass;
+					}
+					continue;
+				}
+				missingLeft = MIN(missingLeft, column);
+				missingTop = MIN(missingTop, row);
+				missingRight = MAX(missingRight, column);
+				missingBottom = MAX(missingBottom, row);
+			}
+		}
+		if(missingRight < 0){
+			break;
+		}
+
+		ofRectangle decodedRegion(missingLeft * tileSize, missingTop * tileSize,
+								  (missingRight - missingLeft + 1) * tileSize, (missingBottom - missingTop + 1) * tileSize);
+		ofPixels_<PixelType> decoded;
+		lock.unlock();
+		bool regionDecoded = decoder->decodeRegion(data, size, decodedRegion, decoded);
+		lock.lock();
+		if(!regionDecoded){
+			return false;
+		}
+
+		//the decoder clipped the region to the frame, tiles outside it are kept empty
+		int decodedLeft = decodedRegion.x, decodedTop = decodedRegion.y;
+		int decodedRight = decodedRegion.getRight(), decodedBottom = decodedRegion.getBottom();
+		for(int row = missingTop; row <= missingBottom; row++){
+			for(int column = missingLeft; column <= missingRight; column++){
+				uint64_t key = getTileKey(index, row, column);
+				if(tiles.find(key) != tiles.end()){
+					continue;
+				}
+				Tile& tile = tiles[key];
+				tile.lastUsed = ++tileClock;
+				int x0 = MAX(column * tileSize, decodedLeft), x1 = MIN((column + 1) * tileSize, decodedRight);
+				int y0 = MAX(row * tileSize, decodedTop), y1 = MIN((row + 1) * tileSize, decodedBottom);
+				if(x1 > x0 && y1 > y0){
+					decoded.cropTo(tile.pixels, x0 - decodedLeft, y0 - decodedTop, x1 - x0, y1 - y0);
+					tileCacheBytes += tile.pixels.size() * sizeof(PixelType);
+					tilesDecoded++;
+				}
+			}
+		}
+	}
+
+	//tiles along the right and bottom edge of the frame are smaller, the region is clipped to them
+	int frameRight = left, frameBottom = top;
+	size_t channels = 0;
+	for(int row = firstRow; row <= lastRow; row++){
+		for(int column = firstColumn; column <= lastColumn; column++){
+			Tile& tile = tiles[getTileKey(index, row, column)];
+			tile.lastUsed = ++tileClock;
+			if(tile.pixels.isAllocated()){
+				frameRight = MAX(frameRight, column * tileSize + (int)tile.pixels.getWidth());
+				frameBottom = MAX(frameBottom, row * tileSize + (int)tile.pixels.getHeight());
+				channels = tile.pixels.getNumChannels();
+			}
+		}
+	}
+	right = MIN(right, frameRight);
+	bottom = MIN(bottom, frameBottom);
+	if(right <= left || bottom <= top){
+		return false;
+	}
+
+	if(pixels.getWidth() != right - left || pixels.getHeight() != bottom - top || pixels.getNumChannels() != channels){
+		pixels.allocate(right - left, bottom - top, channels);
+	}
+	for(int row = firstRow; row <= lastRow; row++){
+		for(int column = firstColumn; column <= lastColumn; column++){
+			const ofPixels_<PixelType>& tilePixels = tiles[getTileKey(index, row, column)].pixels;
+			int x0 = MAX(column * tileSize, left), x1 = MIN(column * tileSize + (int)tilePixels.getWidth(), right);
+			int y0 = MAX(row * tileSize, top), y1 = MIN(row * tileSize + (int)tilePixels.getHeight(), bottom);
+			if(x1 <= x0 || y1 <= y0 || tilePixels.getNumChannels() != channels){
+				continue;
+			}
+			size_t rowBytes = (x1 - x0) * channels * sizeof(PixelType);
+			for(int y = y0; y < y1; y++){
+				const PixelType* src = tilePixels.getData() + ((y - row * tileSize) * tilePixels.getWidth() + (x0 - column * tileSize)) * channels;
+				PixelType* dst = pixels.getData() + ((y - top) * pixels.getWidth() + (x0 - left)) * channels;
+				memcpy(dst, src, rowBytes);
+			}
+		}
+	}
+
+	trimTileCache(firstUse);
+	return true;
+}
+
+//drops the least recently used tiles until the cache fits, never the ones used since keepFrom
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::trimTileCache(uint64_t keepFrom)
+{
+	while(tileCacheBytes > tileCacheSize && tiles.size() > 0){
+		typename map<uint64_t, Tile>::iterator oldest = tiles.begin();
+		for(typename map<uint64_t, Tile>::iterator it = tiles.begin(); it != tiles.end(); it++){
+			if(it->second.lastUsed < oldest->second.lastUsed){
+				oldest = it;
+			}
+		}
+		if(oldest->second.lastUsed >= keepFrom){
+			return;
+		}
+		tileCacheBytes -= oldest->second.pixels.size() * sizeof(PixelType);
+		tiles.erase(oldest);
+	}
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::clearTileCache()
+{
+	ofScopedLock lock(tileMutex);
+	tiles.clear();
+	tileCacheBytes = 0;
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setTileCacheSize(uint64_t bytes)
+{
+	ofScopedLock lock(tileMutex);
+	tileCacheSize = bytes;
+	trimTileCache(tileClock + 1);
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setRegionOfInterest(const ofRectangle& region)
+{
+	int left = MAX(0, (int)floor(region.x));
+	int top = MAX(0, (int)floor(region.y));
+	int right = ceil(region.x + region.width);
+	int bottom = ceil(region.y + region.height);
+	if(right <= left || bottom <= top){
+		ofLogError("ofxImageSequence::setRegionOfInterest") << "Region of interest is empty";
+		return;
+	}
+
+	ofRectangle rounded(left, top, right - left, bottom - top);
+	if((useRegionOfInterest && rounded == regionOfInterest) || isFrameListLocked("ofxImageSequence::setRegionOfInterest")){
+		return;
+	}
+
+	if(isLoading()){
+		ofLogNotice("ofxImageSequence::setRegionOfInterest") << "Cancelling threaded load, frames will load as they are shown";
+		cancelLoad();
+	}
+
+	regionOfInterest = rounded;
+	useRegionOfInterest = true;
+	reloadFrames();
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::clearRegionOfInterest()
+{
+	if(!useRegionOfInterest || isFrameListLocked("ofxImageSequence::clearRegionOfInterest")){
+		return;
+	}
+	if(isLoading()){
+		cancelLoad();
+	}
+	useRegionOfInterest = false;
+	clearTileCache();
+	reloadFrames();
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::hasRegionOfInterest() const
+{
+	return useRegionOfInterest;
+}
+
+template<typename PixelType>
+ofRectangle ofxImageSequence_<PixelType>::getRegionOfInterest() const
+{
+	return useRegionOfInterest ? regionOfInterest : ofRectangle(0, 0, width, height);
+}
 
-		if(!sequenceRef.preloadAllFilenames()){
-			loading = false;
-			return;
+//frames were decoded for another region, they are decoded again as they are shown
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::reloadFrames()
+{
+	stopDecodeWorker();
+	if(sharedFrames.isWriter()){
+		ofLogNotice("ofxImageSequence::reloadFrames") << "Frames changed size, stopped sharing them";
+		stopSharingFrames();
+	}
+	for(int i = 0; i < frameSlots.size(); i++){
+		if(frameSlots[i] >= 0){
+			releaseSlot(frameSlots[i]);
+			frameSlots[i] = -1;
 		}
+	}
+	resetFrameStates();
+	lastFrameLoaded = -1;
 
-		if(cancelLoading){
-			loading = false;
-			cancelLoading = false;
-			return;
-		}
-	
-		sequenceRef.preloadAllFrames();
-	
-		loading = false;
+	if(totalFrames == 0){
+		return;
+	}
+	if(!loaded){
+		completeLoading();
+		return;
 	}
 
-	void updateThreadedLoad(ofEventArgs& args){
-		if(loading){
-			return;
-		}
-		ofRemoveListener(ofEvents().update, this, &ofxImageSequenceLoader::updateThreadedLoad);
+	loadFrame(currentFrame);
+	updateSize();
+}
 
-		if(sequenceRef.getTotalFrames() > 0){
-			sequenceRef.completeLoading();
-		}
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::enableAdaptiveQuality(bool enable)
+{
+	if(enable == adaptiveQuality){
+		return;
 	}
+	adaptiveQuality = enable;
+	if(!enable){
+		stopDecodeWorker();
+		reducedQuality = false;
+	}
+}
 
-};
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::isAdaptiveQualityEnabled() const
+{
+	return adaptiveQuality;
+}
 
-ofxImageSequence::ofxImageSequence()
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::isShowingFullQuality() const
 {
-	loaded = false;
-	useThread = false;
-	frameRate = 30.0f;
-	lastFrameLoaded = -1;
-	currentFrame = 0;
-	maxFrames = 0;
-	curLoadFrame = 0;
-	threadLoader = NULL;
+	return !reducedQuality;
 }
 
-ofxImageSequence::~ofxImageSequence()
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setProxyReduction(int reduction)
 {
-	unloadSequence();
+	proxyReduction = reduction <= 2 ? 2 : reduction <= 4 ? 4 : 8;
 }
 
-bool ofxImageSequence::loadSequence(string prefix, string filetype,  int startDigit, int endDigit)
+//predicts from the recent cost of frames whether the next one would decode within one frame
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::willMissDeadline() const
 {
-	return loadSequence(prefix, filetype, startDigit, endDigit, 0);
+	return averageFrameMicros > 1000000 / frameRate;
 }
 
-bool ofxImageSequence::loadSequence(string prefix, string filetype,  int startDigit, int endDigit, int numDigits)
+//proxies are decoded on the calling thread and scaled back up so the texture keeps the frame's size.
+//they are skipped for regions of interest and once they cost as much as the frame time
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::loadProxy(int index)
 {
-	unloadSequence();
+	if(useRegionOfInterest || proxyUnsupported || width == 0 || averageProxyMicros > 1000000 / frameRate){
+		return false;
+	}
 
-	char imagename[1024];
-	stringstream format;
-	int numFiles = endDigit - startDigit+1;
-	if(numFiles <= 0 ){
-		ofLogError("ofxImageSequence::loadSequence") << "No image files found.";
+	uint64_t startTime = ofGetElapsedTimeMicros();
+	const char* data;
+	size_t size;
+	if(!readFrameData(index, frameBuffer, data, size)){
+		return false;
+	}
+	shared_ptr<ofxImageSequenceDecoder> decoder = getDecoder(ofFilePath::getFileExt(getFramePath(index)));
+	if(!decoder->decodeProxy(data, size, proxyReduction, proxyFrame)){
+		proxyUnsupported = true;
 		return false;
 	}
 
-	if(numDigits != 0){
-		format <<prefix<<"%0"<<numDigits<<"d."<<filetype;
-	} else{
-		format <<prefix<<"%d."<<filetype; 
+	size_t channels = proxyFrame.getNumChannels();
+	size_t proxyWidth = proxyFrame.getWidth();
+	size_t proxyHeight = proxyFrame.getHeight();
+	if(proxyPixels.getWidth() != width || proxyPixels.getHeight() != height || proxyPixels.getNumChannels() != channels){
+		proxyPixels.allocate(width, height, channels);
 	}
-	
-	for(int i = startDigit; i <= endDigit; i++){
-		sprintf(imagename, format.str().c_str(), i);
-		filenames.push_back(imagename);
-		sequence.push_back(ofPixels());
-		loadFailed.push_back(false);
+	size_t rowSize = proxyPixels.getWidth() * channels;
+	for(size_t y = 0; y < proxyPixels.getHeight(); y++){
+		PixelType* dst = proxyPixels.getData() + y * rowSize;
+		if(y % proxyReduction != 0){
+			memcpy(dst, dst - rowSize, rowSize * sizeof(PixelType));
+			continue;
+		}
+		const PixelType* src = proxyFrame.getData() + MIN(y / proxyReduction, proxyHeight - 1) * proxyWidth * channels;
+		for(size_t x = 0; x < proxyPixels.getWidth(); x++){
+			memcpy(dst + x * channels, src + MIN(x / proxyReduction, proxyWidth - 1) * channels, channels * sizeof(PixelType));
+		}
 	}
-	
-	loaded = true;
-	
-	lastFrameLoaded = -1;
-	loadFrame(0);
-	
-	width  = sequence[0].getWidth();
-	height = sequence[0].getHeight();
+	texture.loadData(proxyPixels);
+	textureBounds.set(0, 0, width, height);
+
+	updateAverage(averageProxyMicros, ofGetElapsedTimeMicros() - startTime);
 	return true;
 }
 
-bool ofxImageSequence::loadSequence(string _folder)
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::requestDecode(int index)
 {
-	unloadSequence();
-
-	folderToLoad = _folder;
-
-	if(useThread){
-		threadLoader = new ofxImageSequenceLoader(this);
-		return true;
+	if(decodeWorker == NULL){
+		decodeWorker = new ofxImageSequenceDecodeWorker_<PixelType>(this);
 	}
+	decodeWorker->request(index);
+}
 
-	if(preloadAllFilenames()){
-		completeLoading();
-		return true;
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::stopDecodeWorker()
+{
+	if(decodeWorker != NULL){
+		delete decodeWorker;
+		decodeWorker = NULL;
 	}
-	
-	return false;
-
+	pendingFrame = -1;
 }
 
-void ofxImageSequence::completeLoading()
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setReducedQuality(bool reduced)
 {
+	if(reduced != reducedQuality){
+		reducedQuality = reduced;
+		qualitySwitches++;
+	}
+}
 
-	if(sequence.size() == 0){
-		ofLogError("ofxImageSequence::completeLoading") << "load failed with empty image sequence";
+//swaps a stand-in for the current frame once the frame is decoded by the loader, a worker or a group:
+//the nearest decoded frame shown in its place, or the proxy shown with adaptive quality
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::updateCurrentFrame(ofEventArgs& args)
+{
+	if(!loaded || currentFrame < 0 || currentFrame >= totalFrames){
 		return;
 	}
-
-	loaded = true;	
-	lastFrameLoaded = -1;
-	loadFrame(0);
-	
-	width  = sequence[0].getWidth();
-	height = sequence[0].getHeight();
-
+	if(pendingFrame >= 0 && pendingFrame < totalFrames){
+		if(!readyFrames.get(pendingFrame) && !failedFrames.get(pendingFrame)){
+			return;
+		}
+		int frame = pendingFrame;
+		pendingFrame = -1;
+		if(frame == currentFrame){
+			lastFrameLoaded = -1;
+			loadFrame(frame);
+			return;
+		}
+	}
+	if(lastFrameLoaded != currentFrame && readyFrames.get(currentFrame)){
+		loadFrame(currentFrame);
+	}
 }
 
-bool ofxImageSequence::preloadAllFilenames()
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::shareFrames(string name, uint64_t capacity)
 {
-    ofDirectory dir;
-	if(extension != ""){
-		dir.allowExt(extension);
+	if(!loaded || lastFrameLoaded < 0){
+		ofLogError("ofxImageSequence::shareFrames") << "Load the sequence before sharing its frames";
+		return false;
 	}
-	
-	if(!ofFile(folderToLoad).exists()){
-		ofLogError("ofxImageSequence::loadSequence") << "Could not find folder " << folderToLoad;
+	if(isAttachedToSharedFrames()){
+		ofLogError("ofxImageSequence::shareFrames") << "Attached sequences can't share frames";
+		return false;
+	}
+	if(trimAlpha){
+		ofLogError("ofxImageSequence::shareFrames") << "Trimmed frames can't be shared, disable alpha trim first";
 		return false;
 	}
 
-	int numFiles;
-	if(maxFrames > 0){
-		numFiles = MIN(dir.listDir(folderToLoad), maxFrames);
+	stopSharingFrames();
+	if(capacity == 0){
+		//sized from a frame that is still decoded, the one shown may have been evicted
+		int sizeFrame = readyFrames.get(lastFrameLoaded) ? lastFrameLoaded : readyFrames.findNext(0, true);
+		if(sizeFrame < 0){
+			ofLogError("ofxImageSequence::shareFrames") << "No frame is decoded to size the shared memory from, pass a capacity";
+			return false;
+		}
+		capacity = (uint64_t)totalFrames * (getFramePixels(sizeFrame).size() * sizeof(PixelType) + 64);
 	}
-	else{	
-		numFiles = dir.listDir(folderToLoad);
+	if(!sharedFrames.create(name, totalFrames, sizeof(PixelType), capacity)){
+		return false;
 	}
+	sharingFrames = true;
 
-    if(numFiles == 0) {
-		ofLogError("ofxImageSequence::loadSequence") << "No image files found in " << folderToLoad;
-		return false;
+	//frames decoded before sharing started, later ones are published as they are decoded
+	for(int i = readyFrames.findNext(0, true); i >= 0; i = readyFrames.findNext(i + 1, true)){
+		publishSharedFrame(i, getFramePixels(i));
 	}
+	return true;
+}
 
-    // read the directory for the images
-	#ifdef TARGET_LINUX
-	dir.sort();
-	#endif
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::stopSharingFrames()
+{
+	if(!sharedFrames.isWriter()){
+		return;
+	}
+	ofScopedLock lock(sharedMutex);
+	sharingFrames = false;
+	sharedFrames.close();
+}
 
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::attachSharedFrames(string name)
+{
+	if(isFrameListLocked("ofxImageSequence::attachSharedFrames")){
+		return false;
+	}
+	unloadSequence();
+	if(!sharedFrames.attach(name, sizeof(PixelType))){
+		return false;
+	}
 
-	for(int i = 0; i < numFiles; i++) {
+	frameSlots.assign(sharedFrames.getNumFrames(), -1);
+	resetFrameStates();
+	sharedFramesSeen = 0;
+	loadStartTime = ofGetElapsedTimeMicros();
+	ofAddListener(ofEvents().update, this, &ofxImageSequence_<PixelType>::updateSharedFrames);
 
-        filenames.push_back(dir.getPath(i));
-		sequence.push_back(ofPixels());
-		loadFailed.push_back(false);
-    }
+	//pick up the frames that are there already
+	ofEventArgs args;
+	updateSharedFrames(args);
 	return true;
 }
 
-//set to limit the number of frames. negative means no limit
-void ofxImageSequence::setMaxFrames(int newMaxFrames)
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::isSharingFrames() const
 {
-	maxFrames = MAX(newMaxFrames, 0);
-	if(loaded){
-		ofLogError("ofxImageSequence::setMaxFrames") << "Max frames must be called before load";
+	return sharedFrames.isOpen();
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::isAttachedToSharedFrames() const
+{
+	return sharedFrames.isOpen() && !sharedFrames.isWriter();
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::publishSharedFrame(int index, ofPixels_<PixelType>& pixels)
+{
+	ofScopedLock lock(sharedMutex);
+	if(sharedFrames.isWriter()){
+		sharedFrames.publishFrame(index, pixels.getData(), pixels.getWidth(), pixels.getHeight(), pixels.getNumChannels());
 	}
 }
 
-void ofxImageSequence::setExtension(string ext)
+//marks the frames the sharing process published since the last update as ready. the frames are only
+//looked through when the published count changed, it is read first so frames published during the
+//scan are picked up on the next update
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::updateSharedFrames(ofEventArgs& args)
 {
-	extension = ext;
+	uint64_t published = sharedFrames.getNumPublished();
+	if(published != sharedFramesSeen){
+		sharedFramesSeen = published;
+		for(int i = claimedFrames.findNext(0, false); i >= 0; i = claimedFrames.findNext(i + 1, false)){
+			if(sharedFrames.isFrameReady(i)){
+				decodeFrame(i, frameBuffer);
+			}
+		}
+	}
+
+	if(!loaded){
+		if(numFramesReady > 0){
+			completeLoading();
+		}
+	}
+	else if(lastFrameLoaded != currentFrame){
+		loadFrame(currentFrame);
+	}
 }
 
-void ofxImageSequence::enableThreadedLoad(bool enable){
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setMemoryBudget(uint64_t bytes)
+{
+	automaticMemoryBudget = bytes == 0;
+	if(automaticMemoryBudget){
+		if(totalFrames > 0){
+			startMemoryMonitor();
+		}
+		return;
+	}
 
-	if(loaded){
-		ofLogError("ofxImageSequence::enableThreadedLoad") << "Need to enable threaded loading before calling load";
+	underMemoryPressure = false;
+	uint64_t previousBudget = memoryBudget;
+	memoryBudget = bytes;
+	if(previousBudget != bytes){
+		ofxImageSequenceMemoryEventArgs args;
+		args.limitBytes = 0;
+		args.availableBytes = 0;
+		readMemoryInfo(args.limitBytes, args.availableBytes);
+		args.previousBudget = previousBudget;
+		args.budget = bytes;
+		args.underPressure = false;
+		ofNotifyEvent(memoryEvent, args, this);
 	}
-	useThread = enable;
+	trimFrames(bytes);
+	//frames decoded on demand later are trimmed on every update
+	startMemoryMonitor();
 }
 
-void ofxImageSequence::cancelLoad()
+template<typename PixelType>
+uint64_t ofxImageSequence_<PixelType>::getMemoryBudget() const
 {
-	if(useThread && threadLoader != NULL){
-        threadLoader->cancel();
-        
-		delete threadLoader;
-		threadLoader = NULL;
+	return memoryBudget;
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setMemoryWatermark(float fraction)
+{
+	memoryWatermark = ofClamp(fraction, 0, 1);
+}
+
+//the default budget is half the memory limit, or three quarters of what is left if that is less.
+//a fixed budget is only trimmed to, without reading the memory info
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::startMemoryMonitor()
+{
+	if(automaticMemoryBudget){
+		uint64_t limit, available;
+		if(!readMemoryInfo(limit, available)){
+			return;
+		}
+
+		//0 means no budget, an automatic one never drops that far
+		defaultMemoryBudget = MAX(MIN(limit / 2, decodedBytes + available / 4 * 3), 1);
+		memoryBudget = defaultMemoryBudget;
+		underMemoryPressure = false;
+		lastMemoryCheckTime = ofGetElapsedTimeMillis();
+	}
+	if(!monitoringMemory && memoryBudget > 0){
+		ofAddListener(ofEvents().update, this, &ofxImageSequence_<PixelType>::updateMemoryMonitor);
+		monitoringMemory = true;
 	}
 }
 
-void ofxImageSequence::setMinMagFilter(int newMinFilter, int newMagFilter)
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::stopMemoryMonitor()
 {
-	minFilter = newMinFilter;
-	magFilter = newMagFilter;
-	texture.setTextureMinMagFilter(minFilter, magFilter);
+	if(monitoringMemory){
+		ofRemoveListener(ofEvents().update, this, &ofxImageSequence_<PixelType>::updateMemoryMonitor);
+		monitoringMemory = false;
+	}
+	underMemoryPressure = false;
 }
 
-void ofxImageSequence::preloadAllFrames()
+//below the watermark the budget drops to free twice the shortfall, so the next check isn't right at it again.
+//once there is twice the watermark available the budget grows back towards the default
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::updateMemoryMonitor(ofEventArgs& args)
 {
-	if(sequence.size() == 0){
-		ofLogError("ofxImageSequence::loadFrame") << "Calling preloadAllFrames on unitialized image sequence.";
+	unsigned long long now = ofGetElapsedTimeMillis();
+	if(automaticMemoryBudget && now - lastMemoryCheckTime >= OFX_IMAGE_SEQUENCE_MEMORY_POLL_MILLIS){
+		lastMemoryCheckTime = now;
+		uint64_t limit, available;
+		if(readMemoryInfo(limit, available)){
+			uint64_t lowWatermark = limit * memoryWatermark;
+			uint64_t budget = memoryBudget;
+			uint64_t held = decodedBytes;
+			bool pressure = available < lowWatermark;
+			if(pressure){
+				uint64_t shortfall = (lowWatermark - available) * 2;
+				//at the least the budget keeps the current frame, evicting everything else
+				budget = MAX(MIN(budget, held > shortfall ? held - shortfall : 0), 1);
+			}
+			else if(budget < defaultMemoryBudget && available > lowWatermark * 2){
+				budget = MAX(MIN(defaultMemoryBudget, held + (available - lowWatermark * 2) / 2), 1);
+			}
+			changeMemoryBudget(budget, limit, available, pressure);
+		}
+	}
+
+	//frames decoded by other threads since the last update
+	trimFrames(memoryBudget);
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::changeMemoryBudget(uint64_t budget, uint64_t limit, uint64_t available, bool pressure)
+{
+	if(budget == memoryBudget && pressure == underMemoryPressure){
 		return;
 	}
-	
-	for(int i = 0; i < sequence.size(); i++){
-		//threaded stuff
-		if(useThread){
-			if(threadLoader == NULL){
-				return;
-			}
-            threadLoader->lock();
-            bool shouldExit = threadLoader->cancelLoading;
-            threadLoader->unlock();
-            if(shouldExit){
-                return;
-            }
+	if(pressure && !underMemoryPressure){
+		pressureEvents++;
+		ofLogWarning("ofxImageSequence::updateMemoryMonitor") << "Low on memory, " << available / (1024 * 1024)
+			<< "MB left, lowering the frame budget to " << budget / (1024 * 1024) << "MB";
+	}
 
-			ofSleepMillis(15);
+	ofxImageSequenceMemoryEventArgs args;
+	args.limitBytes = limit;
+	args.availableBytes = available;
+	args.previousBudget = memoryBudget;
+	args.budget = budget;
+	args.underPressure = pressure;
+	memoryBudget = budget;
+	underMemoryPressure = pressure;
+	ofNotifyEvent(memoryEvent, args, this);
+}
+
+//evicts the decoded frames farthest from the current one until the frames fit the budget
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::trimFrames(uint64_t budget)
+{
+	while(budget > 0 && decodedBytes > budget){
+		int first = readyFrames.findNext(0, true);
+		int last = readyFrames.findPrevious(totalFrames - 1, true);
+		if(first < 0){
+			return;
 		}
-		curLoadFrame = i;
-		if(!ofLoadImage(sequence[i], filenames[i])){
-			loadFailed[i] = true;
-			ofLogError("ofxImageSequence::loadFrame") << "Image failed to load: " << filenames[i];		
+		int farthest = currentFrame - first >= last - currentFrame ? first : last;
+		if(farthest == currentFrame){
+			return;
 		}
+		evictFrame(farthest);
+	}
+}
+
+//only the main thread evicts, and only ready frames, which no other thread writes to.
+//the texture keeps showing the frame if it was the last one loaded
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::evictFrame(int index)
+{
+	readyFrames.reset(index);
+	numFramesReady--;
+	int slot = frameSlots[index];
+	frameSlots[index] = -1;
+	ofPixels_<PixelType>& pixels = getSlotPixels(slot);
+	decodedBytes -= pixels.size() * sizeof(PixelType);
+	releaseSlot(slot);
+	claimedFrames.reset(index);
+	framesEvicted++;
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::enableAlphaTrim(bool enable)
+{
+	if(enable == trimAlpha || isFrameListLocked("ofxImageSequence::enableAlphaTrim")){
+		return;
+	}
+	if(isLoading()){
+		ofLogNotice("ofxImageSequence::enableAlphaTrim") << "Cancelling threaded load, frames will load as they are shown";
+		cancelLoad();
+	}
+	trimAlpha = enable;
+	if(totalFrames > 0){
+		reloadFrames();
+	}
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::isAlphaTrimEnabled() const
+{
+	return trimAlpha;
+}
+
+template<typename PixelType>
+ofRectangle ofxImageSequence_<PixelType>::getFrameBounds(int index)
+{
+	if(index < 0 || index >= totalFrames || !readyFrames.get(index)){
+		return ofRectangle();
+	}
+	return getSlot(frameSlots[index]).bounds;
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::lockFrameList()
+{
+	frameListLocks++;
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::unlockFrameList()
+{
+	frameListLocks--;
+}
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::isFrameListLocked(string caller) const
+{
+	if(frameListLocks > 0){
+		ofLogWarning(caller) << "Frames are being decoded by a group or an exporter, stop it first";
+		return true;
 	}
+	return false;
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setReadAheadFrames(int frames)
+{
+	readAheadFrames = MAX(frames, 0);
+}
+
+template<typename PixelType>
+ofxImageSequenceStats ofxImageSequence_<PixelType>::getStats() const
+{
+	ofxImageSequenceStats stats;
+	stats.framesRead = framesRead;
+	stats.bytesRead = bytesRead;
+	stats.ioMicros = ioMicros;
+	stats.framesDecoded = framesDecoded;
+	stats.decodeMicros = decodeMicros;
+	stats.timeToFirstFrameMicros = timeToFirstFrameMicros;
+	stats.decodedBytes = decodedBytes;
+	stats.tilesDecoded = tilesDecoded;
+	stats.tilesReused = tilesReused;
+	stats.tileCacheBytes = tileCacheBytes;
+	stats.averageFrameMicros = averageFrameMicros;
+	stats.missedDeadlines = missedDeadlines;
+	stats.qualitySwitches = qualitySwitches;
+	stats.memoryBudget = memoryBudget;
+	stats.framesEvicted = framesEvicted;
+	stats.pressureEvents = pressureEvents;
+	stats.trimmedBytes = trimmedBytes;
+	stats.transparentFrames = transparentFrames;
+	return stats;
+}
+
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::resetStats()
+{
+	framesRead = 0;
+	bytesRead = 0;
+	ioMicros = 0;
+	framesDecoded = 0;
+	decodeMicros = 0;
+	timeToFirstFrameMicros = 0;
+	tilesDecoded = 0;
+	tilesReused = 0;
+	averageFrameMicros = 0;
+	averageProxyMicros = 0;
+	missedDeadlines = 0;
+	qualitySwitches = 0;
+	framesEvicted = 0;
+	pressureEvents = 0;
+	trimmedBytes = 0;
+	transparentFrames = 0;
 }
 
-float ofxImageSequence::percentLoaded(){
+template<typename PixelType>
+float ofxImageSequence_<PixelType>::percentLoaded(){
+	//a threaded load counts as loaded once its first frame is ready, long before it is done
+	if(isLoading()){
+		return totalFrames > 0 ? 1.0*(numFramesReady + numFramesFailed) / totalFrames : 0.0;
+	}
 	if(isLoaded()){
 		return 1.0;
 	}
-	if(isLoading() && sequence.size() > 0){
-		return 1.0*curLoadFrame / sequence.size();
-	}
 	return 0.0;
 }
 
-void ofxImageSequence::loadFrame(int imageIndex)
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::loadFrame(int imageIndex)
 {
 	if(lastFrameLoaded == imageIndex){
 		return;
 	}
 
-	if(imageIndex < 0 || imageIndex >= sequence.size()){
+	if(imageIndex < 0 || imageIndex >= totalFrames){
 		ofLogError("ofxImageSequence::loadFrame") << "Calling a frame out of bounds: " << imageIndex;
 		return;
 	}
 
-	if(!sequence[imageIndex].isAllocated() && !loadFailed[imageIndex]){
-		if(!ofLoadImage(sequence[imageIndex], filenames[imageIndex])){
-			loadFailed[imageIndex] = true;
-			ofLogError("ofxImageSequence::loadFrame") << "Image failed to load: " << filenames[imageIndex];
+	//attached sequences can only show frames the sharing process has published
+	if(!claimedFrames.get(imageIndex) && (!isAttachedToSharedFrames() || sharedFrames.isFrameReady(imageIndex))){
+		if(isLoading()){
+			//the nearest decoded frame is shown below, the frame decodes in the background alongside the loader
+			requestDecode(imageIndex);
+		}
+		else if(adaptiveQuality && willMissDeadline()){
+			//decoding here would hold the app past the frame's deadline
+			requestDecode(imageIndex);
+		}
+		else{
+			uint64_t startTime = ofGetElapsedTimeMicros();
+			decodeFrame(imageIndex, frameBuffer);
+			//a miss usually means the frames after it are not cached either
+			adviseFrames(imageIndex + 1, readAheadFrames);
+			if(adaptiveQuality && ofGetElapsedTimeMicros() - startTime > 1000000 / frameRate){
+				missedDeadlines++;
+			}
 		}
 	}
 
-	if(loadFailed[imageIndex]){
-		return;
+	//show a stand-in until the full frame is ready, once per frame however often it is asked for
+	if(adaptiveQuality && !readyFrames.get(imageIndex) && !failedFrames.get(imageIndex) && pendingFrame != imageIndex){
+		missedDeadlines++;
+		pendingFrame = imageIndex;
+		if(loadProxy(imageIndex)){
+			setReducedQuality(true);
+			lastFrameLoaded = imageIndex;
+			return;
+		}
+	}
+
+	//failed, or still being decoded by the loader thread. show the closest frame we have instead
+	int frameToShow = imageIndex;
+	if(!readyFrames.get(imageIndex)){
+		frameToShow = getNearestReadyFrame(imageIndex);
+		if(frameToShow < 0 || frameToShow == lastFrameLoaded){
+			return;
+		}
 	}
 
-	texture.loadData(sequence[imageIndex]);
+	//transparent frames have nothing to upload
+	ofPixels_<PixelType>& pixels = getFramePixels(frameToShow);
+	if(pixels.isAllocated()){
+		texture.loadData(pixels);
+	}
+	textureBounds = getFrameBounds(frameToShow);
 
-	lastFrameLoaded = imageIndex;
+	lastFrameLoaded = frameToShow;
+	if(adaptiveQuality){
+		setReducedQuality(frameToShow != imageIndex && !failedFrames.get(imageIndex));
+	}
 
 }
 
-float ofxImageSequence::getPercentAtFrameIndex(int index)
+template<typename PixelType>
+float ofxImageSequence_<PixelType>::getPercentAtFrameIndex(int index)
 {
-	return ofMap(index, 0, sequence.size()-1, 0, 1.0, true);
+	return ofMap(index, 0, totalFrames-1, 0, 1.0, true);
 }
 
-float ofxImageSequence::getWidth() const
+template<typename PixelType>
+float ofxImageSequence_<PixelType>::getWidth() const
 {
 	return width;
 }
 
-float ofxImageSequence::getHeight() const
+template<typename PixelType>
+float ofxImageSequence_<PixelType>::getHeight() const
 {
 	return height;
 }
 
-void ofxImageSequence::unloadSequence()
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::unloadSequence()
 {
 	if(threadLoader != NULL){
 		delete threadLoader;
 		threadLoader = NULL;
 	}
 
-	sequence.clear();
+	stopDecodeWorker();
+	stopFolderWatch();
+	stopMemoryMonitor();
+	if(isAttachedToSharedFrames()){
+		ofRemoveListener(ofEvents().update, this, &ofxImageSequence_<PixelType>::updateSharedFrames);
+	}
+
+	frameSlots.clear();
 	filenames.clear();
-	loadFailed.clear();
+	archive.close();
+	archiveMembers.clear();
+	patternPrefix = "";
+	patternSuffix = "";
+	slotMutex.lock();
+	slots.clear();
+	freeSlots.clear();
+	slotMutex.unlock();
+	sharedMutex.lock();
+	sharingFrames = false;
+	sharedFrames.close();
+	sharedMutex.unlock();
+	fileStamps.clear();
+	folderToLoad = "";
+	resetFrameStates();
+	clearTileCache();
 
 	loaded = false;
 	width = 0;
 	height = 0;
-	curLoadFrame = 0;
+	textureBounds.set(0, 0, 0, 0);
 	lastFrameLoaded = -1;
 	currentFrame = 0;	
+	resetStats();
 
 }
 
-void ofxImageSequence::setFrameRate(float rate)
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setFrameRate(float rate)
 {
 	frameRate = rate;
 }
 
-string ofxImageSequence::getFilePath(int index){
-	if(index >= 0 && index < filenames.size()){
-		return filenames[index];
+template<typename PixelType>
+string ofxImageSequence_<PixelType>::getFilePath(int index){
+	if(index >= 0 && index < totalFrames){
+		return getFramePath(index);
 	}
 	ofLogError("ofxImageSequence::getFilePath") << "Getting filename outside of range";
 	return "";
 }
 
-int ofxImageSequence::getFrameIndexAtPercent(float percent)
+template<typename PixelType>
+int ofxImageSequence_<PixelType>::getFrameIndexAtPercent(float percent)
 {
     if (percent < 0.0 || percent > 1.0) percent -= floor(percent);
 
-	return MIN((int)(percent*sequence.size()), sequence.size()-1);
+	return MIN((int)(percent*totalFrames), totalFrames-1);
 }
 
 //deprecated
-ofTexture& ofxImageSequence::getTextureReference()
+template<typename PixelType>
+ofTexture& ofxImageSequence_<PixelType>::getTextureReference()
 {
 	return getTexture();
 }
 
 //deprecated
-ofTexture* ofxImageSequence::getFrameAtPercent(float percent)
+template<typename PixelType>
+ofTexture* ofxImageSequence_<PixelType>::getFrameAtPercent(float percent)
 {
 	setFrameAtPercent(percent);
 	return &getTexture();
 }
 
 //deprecated
-ofTexture* ofxImageSequence::getFrameForTime(float time)
+template<typename PixelType>
+ofTexture* ofxImageSequence_<PixelType>::getFrameForTime(float time)
 {
 	setFrameForTime(time);
 	return &getTexture();
 }
 
 //deprecated
-ofTexture* ofxImageSequence::getFrame(int index)
+template<typename PixelType>
+ofTexture* ofxImageSequence_<PixelType>::getFrame(int index)
 {
 	setFrame(index);
 	return &getTexture();
 }
 
-ofTexture& ofxImageSequence::getTextureForFrame(int index)
+template<typename PixelType>
+ofTexture& ofxImageSequence_<PixelType>::getTextureForFrame(int index)
 {
 	setFrame(index);
 	return getTexture();
 }
 
-ofTexture& ofxImageSequence::getTextureForTime(float time)
+template<typename PixelType>
+ofTexture& ofxImageSequence_<PixelType>::getTextureForTime(float time)
 {
 	setFrameForTime(time);
 	return getTexture();
 }
 
-ofTexture& ofxImageSequence::getTextureForPercent(float percent){
+template<typename PixelType>
+ofTexture& ofxImageSequence_<PixelType>::getTextureForPercent(float percent){
 	setFrameAtPercent(percent);
 	return getTexture();
 }
 
-void ofxImageSequence::setFrame(int index)
+template<typename PixelType>
+int ofxImageSequence_<PixelType>::setFrame(int index)
 {
 	if(!loaded){
 		ofLogError("ofxImageSequence::setFrame") << "Calling getFrame on unitialized image sequence.";
-		return;
+		return -1;
 	}
 
 	if(index < 0){
 		ofLogError("ofxImageSequence::setFrame") << "Asking for negative index.";
-		return;
+		return -1;
 	}
 	
 	index %= getTotalFrames();
 	
 	loadFrame(index);
 	currentFrame = index;
+	return lastFrameLoaded;
 }
 
-void ofxImageSequence::setFrameForTime(float time)
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setFrameForTime(float time)
 {
-	float totalTime = sequence.size() / frameRate;
+	float totalTime = totalFrames / frameRate;
 	float percent = time / totalTime;
 	return setFrameAtPercent(percent);	
 }
 
-void ofxImageSequence::setFrameAtPercent(float percent)
+template<typename PixelType>
+void ofxImageSequence_<PixelType>::setFrameAtPercent(float percent)
 {
 	setFrame(getFrameIndexAtPercent(percent));	
 }
 
-ofTexture& ofxImageSequence::getTexture()
+template<typename PixelType>
+ofTexture& ofxImageSequence_<PixelType>::getTexture()
 {
 	return texture;
 }
 
-const ofTexture& ofxImageSequence::getTexture() const
+template<typename PixelType>
+const ofTexture& ofxImageSequence_<PixelType>::getTexture() const
 {
 	return texture;
 }
 
-float ofxImageSequence::getLengthInSeconds()
+template<typename PixelType>
+float ofxImageSequence_<PixelType>::getLengthInSeconds()
 {
 	return getTotalFrames() / frameRate;
 }
 
-int ofxImageSequence::getTotalFrames()
+template<typename PixelType>
+int ofxImageSequence_<PixelType>::getTotalFrames() const
 {
-	return sequence.size();
+	return totalFrames;
 }
 
-bool ofxImageSequence::isLoaded() const{						//returns true if the sequence has been loaded
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::isLoaded() const{						//returns true if the sequence has been loaded
     return loaded;
 }
 
-bool ofxImageSequence::isLoading() const{
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::isLoading() const{
 	return threadLoader != NULL && threadLoader->loading;
 }
+
+template<typename PixelType>
+bool ofxImageSequence_<PixelType>::isWatchingFolder() const{
+	return watchingFolder;
+}
+
+template class ofxImageSequence_<unsigned char>;
+template class ofxImageSequence_<unsigned short>;
+template class ofxImageSequence_<float>;
@@ -38,6 +38,20 @@
  *  If you want truly random frame access with no lag on large images, ofxImageSequence is a good way to go
  *  If you need a movie with alpha channel the only readily available codec is Animation (PNG) which is slow at large resolutions, so this class can help with that
  *  If you want to easily access frames based on percents this class makes that easy
+ *
+ *  ofxImageSequence keeps frames as 8 bit pixels. For 16 bit or HDR sequences use ofxShortImageSequence
+ *  or ofxFloatImageSequence, which load and upload frames at full precision.
+ *
+ *  For frames much bigger than the screen set a region of interest: only that part of each frame is
+ *  decoded and kept, and decoded parts are cached in tiles so panning the region reuses them.
+ *
+ *  Decoded frames can be shared with other processes through shared memory: one sequence calls
+ *  shareFrames after loading, others call attachSharedFrames instead of loading and show the frames
+ *  straight from the shared region without reading or decoding anything.
+ *
+ *  Sequences that are mostly transparent, like overlays, can keep only the part of each frame that has
+ *  any alpha with enableAlphaTrim. Draw them with draw(), which puts each frame's pixels back where
+ *  they belong, the texture only holds the trimmed part.
  * 
  * //TODO: Extend ofBaseDraws
  * //TODO: experiment with storing pixels intead of textures and doing upload every frame
@@ -47,18 +61,102 @@
 #pragma once
 
 #include "ofMain.h"
+#include "ofxImageSequenceDecoder.h"
+#include "ofxImageSequenceArchive.h"
+#include "ofxImageSequenceSharedFrames.h"
+#include <atomic>
+#include <deque>
+#include <set>
+
+//cumulative timings for the read and decode stages of every frame loaded since the sequence was loaded
+struct ofxImageSequenceStats {
+	uint64_t framesRead;
+	uint64_t bytesRead;
+	uint64_t ioMicros;			//time spent reading frame files into memory
+	uint64_t framesDecoded;
+	uint64_t decodeMicros;		//time spent decoding frames from memory
+	uint64_t timeToFirstFrameMicros;	//time from loadSequence until the first frame could be drawn
+	uint64_t decodedBytes;		//memory held by decoded frames
+	uint64_t tilesDecoded;		//region of interest tiles decoded from frame files
+	uint64_t tilesReused;		//region of interest tiles found in the tile cache
+	uint64_t tileCacheBytes;	//memory held by the tile cache
+	uint64_t averageFrameMicros;	//recent average time to read and decode one frame
+	uint64_t missedDeadlines;	//frames that could not be shown at full quality within one frame at the frame rate
+	uint64_t qualitySwitches;	//times adaptive quality went from full quality to a stand-in frame or back
+	uint64_t memoryBudget;		//memory decoded frames may use, 0 if there is no budget
+	uint64_t framesEvicted;		//decoded frames dropped to stay within the budget
+	uint64_t pressureEvents;	//times available memory dropped below the watermark
+	uint64_t trimmedBytes;		//memory and texture upload alpha trim saved on the frames decoded
+	uint64_t transparentFrames;	//frames alpha trim found nothing to keep in
+};
+
+//sent with ofxImageSequence::memoryEvent when memory pressure starts or ends and when the budget changes
+struct ofxImageSequenceMemoryEventArgs {
+	uint64_t limitBytes;		//the cgroup memory limit, or the system's memory without one
+	uint64_t availableBytes;	//memory the process can still get, the lower of the system's and the cgroup's
+	uint64_t previousBudget;
+	uint64_t budget;
+	bool underPressure;
+};
+
+//a frame file's modification time and size when it was listed, a rescan decodes the frame again if
+//either changed. seconds alone miss frames rewritten within the same second
+struct ofxImageSequenceFileStamp {
+	int64_t modifiedSeconds;
+	long modifiedNanoseconds;
+	int64_t size;
+
+	bool operator==(const ofxImageSequenceFileStamp& other) const {
+		return modifiedSeconds == other.modifiedSeconds && modifiedNanoseconds == other.modifiedNanoseconds && size == other.size;
+	}
+	bool operator!=(const ofxImageSequenceFileStamp& other) const { return !(*this == other); }
+};
 
-class ofxImageSequenceLoader;
-class ofxImageSequence : public ofBaseHasTexture {
+//fixed size set of per-frame flags that any thread can read and set without taking a lock
+class ofxImageSequenceBitmap {
   public:
+	ofxImageSequenceBitmap();
 
-	ofxImageSequence();
-	~ofxImageSequence();
+	void allocate(int numBits);		//clears all flags, not safe to call while other threads use the bitmap
+	void clear();
+	int size() const;
+
+	bool get(int index) const;
+	bool set(int index);			//returns true if this call changed the flag
+	bool reset(int index);			//returns true if this call changed the flag
+	int count() const;				//number of set flags, scans the words
+	int findNext(int from, bool value) const;	//first index at or after from with the flag set to value, -1 if none
+	int findPrevious(int from, bool value) const;	//last index at or before from with the flag set to value, -1 if none
+
+  protected:
+	unique_ptr<atomic<uint64_t>[]> words;
+	int numBits;
+	int numWords;
+};
+
+template<typename PixelType>
+class ofxImageSequenceLoader_;
+
+template<typename PixelType>
+class ofxImageSequenceDecodeWorker_;
+
+//PixelType is the channel type frames are kept in: unsigned char, unsigned short or float, like ofImage_
+template<typename PixelType>
+class ofxImageSequence_ : public ofBaseHasTexture {
+  public:
+
+	ofxImageSequence_();
+	~ofxImageSequence_();
 	
 	//sets an extension, like png or jpg
 	void setExtension(string prefix);
+	//sets the decoder used for files with an extension, like "jpg". NULL goes back to ofLoadImage. call before loading
+	void setDecoder(string extension, shared_ptr<ofxImageSequenceDecoder> decoder);
+	shared_ptr<ofxImageSequenceDecoder> getDecoder(string extension) const;
 	void setMaxFrames(int maxFrames); //set to limit the number of frames. 0 or less means no limit
 	void enableThreadedLoad(bool enable);
+	void enableFolderWatch(bool enable); //picks up frames added, changed or removed in a loaded folder without reloading it
+
 
 	/**
 	 *	use this method to load sequences formatted like:
@@ -90,11 +188,17 @@ class ofxImageSequence : public ofBaseHasTexture {
 	 *	numDigits	=> 3
 	 */
 	bool loadSequence(string prefix, string filetype, int startIndex, int endIndex, int numDigits);
+
+	/**
+	 *	Loads every file in a folder, or every member of an uncompressed .tar or stored .zip,
+	 *	in name order. Archives are read in place without extracting them.
+	 */
     bool loadSequence(string folder);
 
 	void cancelLoad();
 	void preloadAllFrames();		//immediately loads all frames in the sequence, memory intensive but fastest scrubbing
 	void unloadSequence();			//clears out all frames and frees up memory
+	bool rescanFolder();			//re-lists the loaded folder, keeping decoded frames whose files did not change
 
 	void setFrameRate(float rate); //used for getting frames by time, default is 30fps	
 
@@ -108,7 +212,9 @@ class ofxImageSequence : public ofBaseHasTexture {
 	ofTexture& getTextureForPercent(float percent); //returns a frame at a given time, used setFrameRate to set time
 
 	//if usinsg getTextureRef() use these to change the internal state
-	void setFrame(int index);					
+	//while a threaded load is running a frame that is not decoded yet shows the nearest decoded one until it
+	//is, the texture switches to it on the next update. setFrame returns the index of the frame actually shown
+	int setFrame(int index);					
 	void setFrameForTime(float time);			
 	void setFrameAtPercent(float percent);
 	
@@ -126,47 +232,250 @@ class ofxImageSequence : public ofBaseHasTexture {
 	float getPercentAtFrameIndex(int index);	//returns a frame index for a percent
 	
     int getCurrentFrame(){ return currentFrame; };
-	int getTotalFrames();					//returns how many frames are in the sequence
+	int getTotalFrames() const;				//returns how many frames are in the sequence
 	float getLengthInSeconds();				//returns the sequence duration based on frame rate
 	
-	float getWidth() const;						//returns the width/height of the sequence
+	float getWidth() const;						//returns the width/height of the sequence, before alpha trim
 	float getHeight() const;
-	bool isLoaded() const;						//returns true if the sequence has been loaded
+	bool isLoaded() const;						//returns true once the first frame can be drawn, threaded loads may still be running
 	bool isLoading() const;						//returns true if loading during thread
+	bool isWatchingFolder() const;				//returns true if the loaded folder is being watched for changes
+
+	//these never block and are safe to call while the loader thread is running
+	bool isFrameReady(int index) const;			//returns true if the frame is decoded and can be shown without a stall
+	bool isFrameFailed(int index) const;		//returns true if the frame could not be loaded
+	int getNumFramesReady() const;				//returns how many frames are decoded
+	int getNearestReadyFrame(int index) const;	//returns the decoded frame closest to index, -1 if none are
+	vector<pair<int, int> > getReadyRanges() const; //returns first and last index of each run of decoded frames
 	void loadFrame(int imageIndex);			//allows you to load (cache) a frame to avoid a stutter when loading. use this to "read ahead" if you want
 	
 	void setMinMagFilter(int minFilter, int magFilter);
 
+	//draws the current frame at the sequence's size, or scaled to w x h, offset by where its trimmed pixels go
+	void draw(float x, float y) const;
+	void draw(float x, float y, float w, float h) const;
+
+	//number of upcoming frames the OS is asked to start reading while the current one decodes. 0 disables it
+	void setReadAheadFrames(int frames);
+	ofxImageSequenceStats getStats() const;
+
+	//decodes and keeps only this part of each frame, in frame pixels. the texture, getWidth and getHeight
+	//become the size of the region. a threaded load running when the region changes is cancelled and
+	//the remaining frames load as they are shown
+	void setRegionOfInterest(const ofRectangle& region);
+	void clearRegionOfInterest();
+	bool hasRegionOfInterest() const;
+	ofRectangle getRegionOfInterest() const;
+	void setTileCacheSize(uint64_t bytes);		//memory kept for decoded region tiles, default 256MB
+
+	//when reading and decoding a frame takes longer than a frame at the frame rate, frames that are not
+	//decoded yet show a reduced resolution proxy, or the nearest decoded frame if the format has no cheap
+	//proxy, while they decode in the background. the full frame replaces it as soon as it is ready
+	void enableAdaptiveQuality(bool enable);
+	bool isAdaptiveQualityEnabled() const;
+	bool isShowingFullQuality() const;			//false while a stand-in is shown for the current frame
+	void setProxyReduction(int reduction);		//2, 4 or 8 times smaller than the frame, default 4
+
+	//copies every decoded frame into a POSIX shared memory region named like "/mySequence". capacity is
+	//the memory for pixels, 0 makes room for every frame at the size of the current one. not on Windows
+	bool shareFrames(string name, uint64_t capacity = 0);
+	void stopSharingFrames();
+	//shows the frames another process shares instead of loading them, frames appear as they are decoded there.
+	//the pixel type has to match the sharing sequence's
+	bool attachSharedFrames(string name);
+	bool isSharingFrames() const;				//true while sharing or attached
+
+	//decoded frames are kept within a memory budget. by default it is chosen when loading from the cgroup v2
+	//memory limit and /proc/meminfo, and lowered while available memory is below the watermark by evicting
+	//the frames farthest from the current one. preloadAllFrames stops at the budget, frames decoded on demand are
+	//evicted down to it on every update, with a fixed budget too. 0 goes back to the default
+	void setMemoryBudget(uint64_t bytes);
+	uint64_t getMemoryBudget() const;			//0 if there is no budget
+	void setMemoryWatermark(float fraction);	//share of the memory limit to keep available, default 0.1
+	ofEvent<ofxImageSequenceMemoryEventArgs> memoryEvent;
+
+	//keeps only the bounding box of the pixels with any alpha in RGBA frames, fully transparent frames
+	//keep and upload nothing. frames decoded already are decoded again. not with shareFrames
+	void enableAlphaTrim(bool enable);
+	bool isAlphaTrimEnabled() const;
+	ofRectangle getFrameBounds(int index);		//where a decoded frame's pixels go in the frame, empty if it is transparent or not decoded
+
 	//Do not call directly
-	//called internally from threaded loader
+	//called internally from threaded loader, ofxImageSequenceGroup and ofxImageSequenceExporter workers
+	bool decodeFrame(int index, ofBuffer& buffer);
+	bool decodeFramePixels(int index, ofPixels_<PixelType>& pixels, ofBuffer& buffer);	//decodes into pixels the caller keeps
+	bool isFrameClaimed(int index) const;
 	void completeLoading();
 	bool preloadAllFilenames();		//searches for all filenames based on load input
 	float percentLoaded();
+	void updateFolderWatch(ofEventArgs& args);
+	void updateCurrentFrame(ofEventArgs& args);
+	void updateSharedFrames(ofEventArgs& args);
+	void updateMemoryMonitor(ofEventArgs& args);
+
+	//held by groups and exporters while their workers decode the sequence. while it is held, loading,
+	//rescanning, region of interest and alpha trim changes are refused, and folder watch rescans wait
+	void lockFrameList();
+	void unlockFrameList();
 
   protected:
-	ofxImageSequenceLoader* threadLoader;
+	bool isFrameListLocked(string caller) const;	//logs a warning for caller when it is
+	void resetFrameStates();
+	string getFramePath(int index) const;
+	int acquireSlot();
+	void releaseSlot(int slot);
+	ofPixels_<PixelType>& getSlotPixels(int slot);
+	ofPixels_<PixelType>& getFramePixels(int index);
+	void updateSize();
+	void trimFrame(ofPixels_<PixelType>& pixels, ofRectangle& bounds);
+	bool readFrame(int index, ofBuffer& buffer);
+	bool readFrameData(int index, ofBuffer& buffer, const char*& data, size_t& size);
+	bool loadFramePixels(int index, ofPixels_<PixelType>& pixels, ofBuffer& buffer);
+	void adviseFrames(int fromIndex, int count);
+	void resetStats();
+	bool decodeRegion(int index, const char* data, size_t size, shared_ptr<ofxImageSequenceDecoder> decoder, ofPixels_<PixelType>& pixels);
+	void reloadFrames();
+	void trimTileCache(uint64_t keepFrom);
+	void clearTileCache();
+	bool willMissDeadline() const;
+	bool loadProxy(int index);
+	void requestDecode(int index);
+	void stopDecodeWorker();
+	void setReducedQuality(bool reduced);
+	bool isAttachedToSharedFrames() const;
+	void publishSharedFrame(int index, ofPixels_<PixelType>& pixels);
+	void startMemoryMonitor();
+	void stopMemoryMonitor();
+	void changeMemoryBudget(uint64_t budget, uint64_t limit, uint64_t available, bool pressure);
+	void trimFrames(uint64_t budget);
+	void evictFrame(int index);
+
+	bool listFolder(vector<string>& paths);
+	bool listArchive(vector<string>& paths);
+	bool updateChangedFiles();
+	bool replaceFrameList(vector<string>& paths, vector<ofxImageSequenceFileStamp>& stamps, const set<string>& written, bool retryFailed);
+	void startFolderWatch();
+	void stopFolderWatch();
+
+	ofxImageSequenceLoader_<PixelType>* threadLoader;
+
+	//per frame there are only the state flags and the index of the slot holding its pixels, -1 if none.
+	//pattern sequences don't store file names either, they are formatted when a frame is read
+	struct Slot {
+		ofPixels_<PixelType> pixels;
+		ofRectangle bounds;			//where the pixels go in the frame, smaller than it when alpha is trimmed
+		float frameWidth, frameHeight;
+	};
+	Slot& getSlot(int slot);
+	vector<int> frameSlots;
+	deque<Slot> slots;
+	vector<int> freeSlots;
+	ofMutex slotMutex;
 
-	vector<ofPixels> sequence;
 	vector<string> filenames;
-	vector<bool> loadFailed;
+	ofxImageSequenceArchive archive;
+	vector<int> archiveMembers;
+	string patternPrefix;
+	string patternSuffix;
+	int patternStart;
+	int patternDigits;
+	vector<ofxImageSequenceFileStamp> fileStamps;
+
+	//a frame is claimed by the first thread to start decoding it, then marked ready or failed
+	ofxImageSequenceBitmap claimedFrames;
+	ofxImageSequenceBitmap readyFrames;
+	ofxImageSequenceBitmap failedFrames;
+	atomic<int> numFramesReady;
+	atomic<int> numFramesFailed;
+	atomic<int> totalFrames;		//published once the frame list is complete
+	atomic<uint64_t> decodedBytes;
 	int currentFrame;
 	ofTexture texture;
+	ofRectangle textureBounds;		//where the texture goes in the frame
 	string extension;
 	
 	string folderToLoad;
-	int curLoadFrame;
 	int maxFrames;
 	bool useThread;
 	bool loaded;
 
+	bool watchFolder;
+	bool watchingFolder;
+	bool folderChanged;
+	bool filesWritten;			//a watched file was written or moved in since the last rescan
+	set<string> changedFiles;	//names inotify reported since the frame list was last updated
+	int inotifyDescriptor;
+	int watchDescriptor;
+	unsigned long long lastFolderScanTime;
+
 	float width, height;
 	int lastFrameLoaded;
 	float frameRate;
 	
 	int minFilter;
 	int magFilter;
-};
 
+	map<string, shared_ptr<ofxImageSequenceDecoder> > decoders;
+	shared_ptr<ofxImageSequenceDecoder> defaultDecoder;
+	ofBuffer frameBuffer;
+	int readAheadFrames;
+	atomic<uint64_t> framesRead;
+	atomic<uint64_t> bytesRead;
+	atomic<uint64_t> ioMicros;
+	atomic<uint64_t> framesDecoded;
+	atomic<uint64_t> decodeMicros;
+	atomic<uint64_t> timeToFirstFrameMicros;
+	uint64_t loadStartTime;
+
+	struct Tile {
+		ofPixels_<PixelType> pixels;	//empty for tiles outside the frame
+		uint64_t lastUsed;
+	};
+	ofRectangle regionOfInterest;
+	bool useRegionOfInterest;
+	map<uint64_t, Tile> tiles;		//keyed by frame index, tile row and tile column
+	uint64_t tileCacheSize;
+	uint64_t tileClock;
+	int lastRegionFrame;			//frame of the last region decode, its next decode gets a margin
+	atomic<uint64_t> tileCacheBytes;
+	atomic<uint64_t> tilesDecoded;
+	atomic<uint64_t> tilesReused;
+	ofMutex tileMutex;
+
+	bool adaptiveQuality;
+	bool reducedQuality;
+	bool proxyUnsupported;
+	int proxyReduction;
+	int pendingFrame;			//frame waiting for its full quality version, -1 if none
+	ofPixels_<PixelType> proxyFrame;
+	ofPixels_<PixelType> proxyPixels;
+	ofxImageSequenceDecodeWorker_<PixelType>* decodeWorker;
+	atomic<uint64_t> averageFrameMicros;
+	atomic<uint64_t> averageProxyMicros;
+	atomic<uint64_t> missedDeadlines;
+	atomic<uint64_t> qualitySwitches;
 
+	ofxImageSequenceSharedFrames sharedFrames;
+	atomic<bool> sharingFrames;
+	uint64_t sharedFramesSeen;	//published count when an attached sequence last looked for new frames
+	ofMutex sharedMutex;		//keeps the region mapped while a frame is copied in
 
+	atomic<uint64_t> memoryBudget;
+	atomic<int> frameListLocks;
+	uint64_t defaultMemoryBudget;
+	bool automaticMemoryBudget;
+	float memoryWatermark;
+	bool monitoringMemory;
+	bool underMemoryPressure;
+	unsigned long long lastMemoryCheckTime;
+	atomic<uint64_t> framesEvicted;
+	atomic<uint64_t> pressureEvents;
+
+	bool trimAlpha;
+	atomic<uint64_t> trimmedBytes;
+	atomic<uint64_t> transparentFrames;
+};
 
+typedef ofxImageSequence_<unsigned char> ofxImageSequence;
+typedef ofxImageSequence_<unsigned short> ofxShortImageSequence;
+typedef ofxImageSequence_<float> ofxFloatImageSequence;
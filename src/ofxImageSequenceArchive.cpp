@@ -0,0 +1,390 @@
+/**
+ *  ofxImageSequenceArchive.cpp
+ *
+ *  Part of ofxImageSequence, see ofxImageSequence.h for license terms.
+ */
+
+#include "ofxImageSequenceArchive.h"
+
+#ifdef TARGET_WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define TAR_BLOCK_SIZE				512
+#define ZIP_LOCAL_HEADER_SIGNATURE	0x04034b50
+#define ZIP_CENTRAL_SIGNATURE		0x02014b50
+#define ZIP_END_SIGNATURE			0x06054b50
+#define ZIP64_END_SIGNATURE			0x06064b50
+#define ZIP64_LOCATOR_SIGNATURE		0x07064b50
+#define ZIP64_EXTRA_ID				0x0001
+
+static uint16_t readLittleEndian16(const char* bytes)
+{
+	const unsigned char* b = (const unsigned char*)bytes;
+	return b[0] | (b[1] << 8);
+}
+
+static uint32_t readLittleEndian32(const char* bytes)
+{
+	const unsigned char* b = (const unsigned char*)bytes;
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static uint64_t readLittleEndian64(const char* bytes)
+{
+	return readLittleEndian32(bytes) | ((uint64_t)readLittleEndian32(bytes + 4) << 32);
+}
+
+//tar numbers are NUL or space terminated octal strings
+static uint64_t readOctal(const char* field, size_t length)
+{
+	uint64_t value = 0;
+	for(size_t i = 0; i < length && field[i] >= '0' && field[i] <= '7'; i++){
+		value = value * 8 + (field[i] - '0');
+	}
+	return value;
+}
+
+static string readString(const char* field, size_t length)
+{
+	return string(field, strnlen(field, length));
+}
+
+ofxImageSequenceArchive::ofxImageSequenceArchive()
+{
+	isZip = false;
+	data = NULL;
+	dataSize = 0;
+	#ifdef TARGET_WIN32
+	fileHandle = NULL;
+	mappingHandle = NULL;
+	#endif
+}
+
+ofxImageSequenceArchive::~ofxImageSequenceArchive()
+{
+	close();
+}
+
+bool ofxImageSequenceArchive::isArchive(string path)
+{
+	string ext = ofToLower(ofFilePath::getFileExt(path));
+	return ext == "tar" || ext == "zip";
+}
+
+bool ofxImageSequenceArchive::open(string path)
+{
+	close();
+
+	if(!mapFile(ofToDataPath(path))){
+		ofLogError("ofxImageSequenceArchive::open") << "Could not map " << path;
+		return false;
+	}
+
+	isZip = ofToLower(ofFilePath::getFileExt(path)) == "zip";
+	if(!(isZip ? indexZip() : indexTar())){
+		ofLogError("ofxImageSequenceArchive::open") << path << " is not a readable " << (isZip ? "zip" : "tar") << " archive";
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool ofxImageSequenceArchive::mapFile(string path)
+{
+	#ifdef TARGET_WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if(file == INVALID_HANDLE_VALUE){
+		return false;
+	}
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file, &size) || size.QuadPart == 0){
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(mapping == NULL){
+		CloseHandle(file);
+		return false;
+	}
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if(data == NULL){
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	mappingHandle = mapping;
+	dataSize = size.QuadPart;
+	#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd < 0){
+		return false;
+	}
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size == 0){
+		::close(fd);
+		return false;
+	}
+	void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	//the mapping keeps the file referenced
+	::close(fd);
+	if(mapped == MAP_FAILED){
+		return false;
+	}
+	//frames are visited in order but each one is small relative to the archive
+	madvise(mapped, info.st_size, MADV_RANDOM);
+	data = (const char*)mapped;
+	dataSize = info.st_size;
+	#endif
+	return true;
+}
+
+void ofxImageSequenceArchive::close()
+{
+	if(data != NULL){
+		#ifdef TARGET_WIN32
+		UnmapViewOfFile(data);
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		mappingHandle = NULL;
+		fileHandle = NULL;
+		#else
+		munmap((void*)data, dataSize);
+		#endif
+	}
+	data = NULL;
+	dataSize = 0;
+	members.clear();
+}
+
+bool ofxImageSequenceArchive::isOpen() const
+{
+	return data != NULL;
+}
+
+//walks the member headers, skipping over member data without reading it
+bool ofxImageSequenceArchive::indexTar()
+{
+	uint64_t pos = 0;
+	string longName;
+	while(pos + TAR_BLOCK_SIZE <= dataSize){
+		const char* header = data + pos;
+		if(header[0] == '\0'){
+			//two zero blocks end the archive
+			break;
+		}
+
+		uint64_t size = readOctal(header + 124, 12);
+		char type = header[156];
+		uint64_t dataOffset = pos + TAR_BLOCK_SIZE;
+		if(dataOffset + size > dataSize){
+			return false;
+		}
+
+		if(type == 'L'){
+			//GNU long name, the name is the data of this entry and applies to the next one
+			longName = readString(data + dataOffset, size);
+		}
+		else if(type == 'x'){
+			//pax extended header, made of "<length> <key>=<value>\n" records
+			string records(data + dataOffset, size);
+			size_t recordStart = 0;
+			while(recordStart < records.size()){
+				size_t space = records.find(' ', recordStart);
+				if(space == string::npos){
+					break;
+				}
+				size_t recordLength = atoi(records.c_str() + recordStart);
+				if(recordLength == 0){
+					break;
+				}
+				string record = records.substr(space + 1, recordStart + recordLength - space - 2);
+				if(record.compare(0, 5, "path=") == 0){
+					longName = record.substr(5);
+				}
+				recordStart += recordLength;
+			}
+		}
+		else{
+			if(type == '0' || type == '\0'){
+				Member member;
+				if(longName != ""){
+					member.name = longName;
+				}
+				else{
+					string prefix = memcmp(header + 257, "ustar", 5) == 0 ? readString(header + 345, 155) : "";
+					member.name = readString(header, 100);
+					if(prefix != ""){
+						member.name = prefix + "/" + member.name;
+					}
+				}
+				member.offset = dataOffset;
+				member.size = size;
+				members.push_back(member);
+			}
+			longName = "";
+		}
+
+		pos = dataOffset + (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+	}
+	return true;
+}
+
+//reads the central directory at the end of the archive, local headers are only read when a member is used
+bool ofxImageSequenceArchive::indexZip()
+{
+	if(dataSize < 22){
+		return false;
+	}
+
+	//the end record sits at the very end, followed by a comment of up to 64k
+	int64_t endPos = -1;
+	int64_t searchStart = dataSize - 22;
+	int64_t searchEnd = MAX((int64_t)0, searchStart - 65535);
+	for(int64_t pos = searchStart; pos >= searchEnd; pos--){
+		if(readLittleEndian32(data + pos) == ZIP_END_SIGNATURE){
+			endPos = pos;
+			break;
+		}
+	}
+	if(endPos < 0){
+		return false;
+	}
+
+	uint64_t numEntries = readLittleEndian16(data + endPos + 10);
+	uint64_t directorySize = readLittleEndian32(data + endPos + 12);
+	uint64_t directoryOffset = readLittleEndian32(data + endPos + 16);
+
+	//archives over 65535 members or 4GB keep the real values in the zip64 end record
+	if(endPos >= 20 && readLittleEndian32(data + endPos - 20) == ZIP64_LOCATOR_SIGNATURE){
+		uint64_t zip64EndPos = readLittleEndian64(data + endPos - 20 + 8);
+		if(zip64EndPos + 56 > dataSize || readLittleEndian32(data + zip64EndPos) != ZIP64_END_SIGNATURE){
+			return false;
+		}
+		numEntries = readLittleEndian64(data + zip64EndPos + 32);
+		directorySize = readLittleEndian64(data + zip64EndPos + 40);
+		directoryOffset = readLittleEndian64(data + zip64EndPos + 48);
+	}
+
+	if(directoryOffset + directorySize > dataSize){
+		return false;
+	}
+
+	members.reserve(numEntries);
+	uint64_t pos = directoryOffset;
+	int numCompressed = 0;
+	for(uint64_t i = 0; i < numEntries; i++){
+		if(pos + 46 > dataSize || readLittleEndian32(data + pos) != ZIP_CENTRAL_SIGNATURE){
+			return false;
+		}
+		const char* entry = data + pos;
+		uint16_t method = readLittleEndian16(entry + 10);
+		uint64_t compressedSize = readLittleEndian32(entry + 20);
+		uint64_t size = readLittleEndian32(entry + 24);
+		uint16_t nameLength = readLittleEndian16(entry + 28);
+		uint16_t extraLength = readLittleEndian16(entry + 30);
+		uint16_t commentLength = readLittleEndian16(entry + 32);
+		uint64_t localHeaderOffset = readLittleEndian32(entry + 42);
+		if(pos + 46 + nameLength + extraLength > dataSize){
+			return false;
+		}
+		string name(entry + 46, nameLength);
+
+		//values that don't fit 32 bits are 0xFFFFFFFF here and follow in order in the zip64 extra field
+		const char* extra = entry + 46 + nameLength;
+		const char* extraEnd = extra + extraLength;
+		while(extra + 4 <= extraEnd){
+			uint16_t id = readLittleEndian16(extra);
+			uint16_t length = readLittleEndian16(extra + 2);
+			if(id == ZIP64_EXTRA_ID){
+				const char* field = extra + 4;
+				if(size == 0xFFFFFFFF && field + 8 <= extra + 4 + length){
+					size = readLittleEndian64(field);
+					field += 8;
+				}
+				if(compressedSize == 0xFFFFFFFF && field + 8 <= extra + 4 + length){
+					compressedSize = readLittleEndian64(field);
+					field += 8;
+				}
+				if(localHeaderOffset == 0xFFFFFFFF && field + 8 <= extra + 4 + length){
+					localHeaderOffset = readLittleEndian64(field);
+				}
+				break;
+			}
+			extra += 4 + length;
+		}
+
+		bool isDirectory = name.size() > 0 && name[name.size() - 1] == '/';
+		if(!isDirectory){
+			if(method == 0 && compressedSize == size){
+				Member member;
+				member.name = name;
+				member.offset = localHeaderOffset;
+				member.size = size;
+				members.push_back(member);
+			}
+			else{
+				numCompressed++;
+			}
+		}
+
+		pos += 46 + nameLength + extraLength + commentLength;
+	}
+
+	if(numCompressed > 0){
+		ofLogWarning("ofxImageSequenceArchive::open") << "Skipped " << numCompressed << " compressed members, only stored (zip -0) members can be read in place";
+	}
+	return true;
+}
+
+int ofxImageSequenceArchive::getNumMembers() const
+{
+	return members.size();
+}
+
+string ofxImageSequenceArchive::getMemberName(int member) const
+{
+	return members[member].name;
+}
+
+size_t ofxImageSequenceArchive::getMemberSize(int member) const
+{
+	return members[member].size;
+}
+
+const char* ofxImageSequenceArchive::getMemberData(int member) const
+{
+	const Member& m = members[member];
+	uint64_t dataOffset = m.offset;
+	if(isZip){
+		//the local header repeats the name and may have a different extra field than the central directory
+		if(m.offset + 30 > dataSize || readLittleEndian32(data + m.offset) != ZIP_LOCAL_HEADER_SIGNATURE){
+			return NULL;
+		}
+		dataOffset = m.offset + 30 + readLittleEndian16(data + m.offset + 26) + readLittleEndian16(data + m.offset + 28);
+	}
+	if(dataOffset + m.size > dataSize){
+		return NULL;
+	}
+	return data + dataOffset;
+}
+
+void ofxImageSequenceArchive::adviseMember(int member) const
+{
+	#ifndef TARGET_WIN32
+	const char* memberData = getMemberData(member);
+	if(memberData == NULL){
+		return;
+	}
+	//madvise wants a page aligned start
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	uintptr_t start = (uintptr_t)memberData & ~(uintptr_t)(pageSize - 1);
+	madvise((void*)start, (uintptr_t)memberData + members[member].size - start, MADV_WILLNEED);
+	#endif
+}
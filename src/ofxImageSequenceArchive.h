@@ -0,0 +1,62 @@
+/**
+ *  ofxImageSequenceArchive.h
+ *
+ *  Part of ofxImageSequence, see ofxImageSequence.h for license terms.
+ *
+ * ----------------------
+ *
+ *  Read only view of an uncompressed tar or a zip whose members are stored (not deflated).
+ *  The archive is memory mapped and only its headers are read when opening it: the zip central
+ *  directory, or the tar member headers, which are walked without touching the member data.
+ *  Member data is handed out as pointers into the mapping so frames decode straight from the
+ *  page cache without being copied or extracted.
+ *
+ *  Create stored zips with "zip -0 -r frames.zip frames/" and tars with "tar cf frames.tar frames/".
+ */
+
+#pragma once
+
+#include "ofMain.h"
+
+class ofxImageSequenceArchive {
+  public:
+	ofxImageSequenceArchive();
+	~ofxImageSequenceArchive();
+
+	static bool isArchive(string path);		//returns true for paths ending in .tar or .zip
+
+	bool open(string path);
+	void close();
+	bool isOpen() const;
+
+	int getNumMembers() const;
+	string getMemberName(int member) const;
+	size_t getMemberSize(int member) const;
+	const char* getMemberData(int member) const;	//NULL if the member lies outside the archive
+	void adviseMember(int member) const;			//asks the kernel to start paging the member in
+
+  protected:
+	struct Member {
+		string name;
+		uint64_t offset;		//data offset for tar, local header offset for zip
+		uint64_t size;
+	};
+
+	bool mapFile(string path);
+	bool indexTar();
+	bool indexZip();
+
+	vector<Member> members;
+	bool isZip;
+
+	const char* data;
+	uint64_t dataSize;
+	#ifdef TARGET_WIN32
+	void* fileHandle;
+	void* mappingHandle;
+	#endif
+
+  private:
+	ofxImageSequenceArchive(const ofxImageSequenceArchive&);
+	ofxImageSequenceArchive& operator=(const ofxImageSequenceArchive&);
+};
@@ -0,0 +1,772 @@
+/**
+ *  ofxImageSequenceDecoder.cpp
+ *
+ *  Part of ofxImageSequence, see ofxImageSequence.h for license terms.
+ */
+
+#include "ofxImageSequenceDecoder.h"
+
+#ifdef OFX_IMAGE_SEQUENCE_USE_TURBOJPEG
+#include <turbojpeg.h>
+#include <cstdio>
+#include <jpeglib.h>
+#include <setjmp.h>
+#endif
+
+#ifdef OFX_IMAGE_SEQUENCE_USE_SPNG
+#include <spng.h>
+#endif
+
+//only reallocates when the frame doesn't fit the storage it is decoded into
+template<typename PixelType>
+static void allocateFrame(ofPixels_<PixelType>& pixels, size_t width, size_t height, size_t channels)
+{
+	if(!pixels.isAllocated() || pixels.getWidth() != width || pixels.getHeight() != height || pixels.getNumChannels() != channels){
+		pixels.allocate(width, height, channels);
+	}
+}
+
+template<typename PixelType>
+static bool decodeAndConvert(ofxImageSequenceDecoder& decoder, const char* data, size_t size, ofPixels_<PixelType>& pixels)
+{
+	ofPixels decoded;
+	if(!decoder.decode(data, size, decoded)){
+		return false;
+	}
+	pixels = decoded;
+	return true;
+}
+
+//clips region to a frame of the given size and rounds it to whole pixels, false if nothing is left
+static bool clipRegion(ofRectangle& region, size_t width, size_t height)
+{
+	int left = MAX(0, (int)floor(region.x));
+	int top = MAX(0, (int)floor(region.y));
+	int right = MIN((int)width, (int)ceil(region.x + region.width));
+	int bottom = MIN((int)height, (int)ceil(region.y + region.height));
+	if(right <= left || bottom <= top){
+		region.set(0, 0, 0, 0);
+		return false;
+	}
+	region.set(left, top, right - left, bottom - top);
+	return true;
+}
+
+template<typename PixelType>
+static bool decodeAndCrop(ofxImageSequenceDecoder& decoder, const char* data, size_t size, ofRectangle& region, ofPixels_<PixelType>& pixels)
+{
+	ofPixels_<PixelType> frame;
+	if(!decoder.decode(data, size, frame)){
+		return false;
+	}
+	if(!clipRegion(region, frame.getWidth(), frame.getHeight())){
+		pixels.clear();
+		return true;
+	}
+	frame.cropTo(pixels, region.x, region.y, region.width, region.height);
+	return true;
+}
+
+bool ofxImageSequenceDecoder::decodeRegion(const char* data, size_t size, ofRectangle& region, ofPixels& pixels)
+{
+	return decodeAndCrop(*this, data, size, region, pixels);
+}
+
+bool ofxImageSequenceDecoder::decodeRegion(const char* data, size_t size, ofRectangle& region, ofShortPixels& pixels)
+{
+	return decodeAndCrop(*this, data, size, region, pixels);
+}
+
+bool ofxImageSequenceDecoder::decodeRegion(const char* data, size_t size, ofRectangle& region, ofFloatPixels& pixels)
+{
+	return decodeAndCrop(*this, data, size, region, pixels);
+}
+
+bool ofxImageSequenceDecoder::decode(const char* data, size_t size, ofShortPixels& pixels)
+{
+	return decodeAndConvert(*this, data, size, pixels);
+}
+
+bool ofxImageSequenceDecoder::decode(const char* data, size_t size, ofFloatPixels& pixels)
+{
+	return decodeAndConvert(*this, data, size, pixels);
+}
+
+//--------------------------------------------------------------
+bool ofxImageSequenceFreeImageDecoder::decode(const char* data, size_t size, ofPixels& pixels)
+{
+	ofBuffer buffer(data, size);
+	return ofLoadImage(pixels, buffer);
+}
+
+bool ofxImageSequenceFreeImageDecoder::decode(const char* data, size_t size, ofShortPixels& pixels)
+{
+	ofBuffer buffer(data, size);
+	return ofLoadImage(pixels, buffer);
+}
+
+bool ofxImageSequenceFreeImageDecoder::decode(const char* data, size_t size, ofFloatPixels& pixels)
+{
+	ofBuffer buffer(data, size);
+	return ofLoadImage(pixels, buffer);
+}
+
+bool ofxImageSequenceFreeImageDecoder::decode(const ofBuffer& buffer, ofPixels& pixels)
+{
+	return ofLoadImage(pixels, buffer);
+}
+
+bool ofxImageSequenceFreeImageDecoder::decode(const ofBuffer& buffer, ofShortPixels& pixels)
+{
+	return ofLoadImage(pixels, buffer);
+}
+
+bool ofxImageSequenceFreeImageDecoder::decode(const ofBuffer& buffer, ofFloatPixels& pixels)
+{
+	return ofLoadImage(pixels, buffer);
+}
+
+//--------------------------------------------------------------
+static bool readPPMToken(const char* data, size_t size, size_t& pos, int& value)
+{
+	//whitespace and # comments may appear anywhere between header fields
+	while(pos < size){
+		if(data[pos] == '#'){
+			while(pos < size && data[pos] != '\n'){
+				pos++;
+			}
+		}
+		else if(isspace((unsigned char)data[pos])){
+			pos++;
+		}
+		else{
+			break;
+		}
+	}
+
+	if(pos >= size || !isdigit((unsigned char)data[pos])){
+		return false;
+	}
+	value = 0;
+	while(pos < size && isdigit((unsigned char)data[pos])){
+		value = value * 10 + (data[pos] - '0');
+		pos++;
+	}
+	return true;
+}
+
+//rescales a sample from 0..maxValue to the full range of the pixel type
+template<typename PixelType>
+static inline PixelType scaleSample(unsigned int value, unsigned int maxValue);
+
+template<>
+inline unsigned char scaleSample(unsigned int value, unsigned int maxValue)
+{
+	return value * 255 / maxValue;
+}
+
+template<>
+inline unsigned short scaleSample(unsigned int value, unsigned int maxValue)
+{
+	return value * 65535 / maxValue;
+}
+
+template<>
+inline float scaleSample(unsigned int value, unsigned int maxValue)
+{
+	return float(value) / maxValue;
+}
+
+struct PPMHeader {
+	size_t width;
+	size_t height;
+	size_t channels;
+	unsigned int maxValue;
+	size_t bytesPerSample;
+	size_t dataOffset;
+};
+
+static bool readPPMHeader(const char* data, size_t size, PPMHeader& header)
+{
+	if(size < 3 || data[0] != 'P' || (data[1] != '5' && data[1] != '6')){
+		return false;
+	}
+
+	size_t pos = 2;
+	int width, height, maxValue;
+	if(!readPPMToken(data, size, pos, width) ||
+	   !readPPMToken(data, size, pos, height) ||
+	   !readPPMToken(data, size, pos, maxValue)){
+		return false;
+	}
+
+	if(width <= 0 || height <= 0 || maxValue <= 0 || maxValue > 65535){
+		return false;
+	}
+
+	header.width = width;
+	header.height = height;
+	header.channels = data[1] == '5' ? 1 : 3;
+	header.maxValue = maxValue;
+	header.bytesPerSample = maxValue > 255 ? 2 : 1;
+	//exactly one whitespace character separates the header from the samples
+	header.dataOffset = pos + 1;
+	return header.dataOffset + header.width * header.height * header.channels * header.bytesPerSample <= size;
+}
+
+//samples are stored row by row, so a region is read by jumping straight to its rows and columns
+template<typename PixelType>
+static bool decodePPM(const char* data, size_t size, ofRectangle* region, ofPixels_<PixelType>& pixels)
+{
+	PPMHeader header;
+	if(!readPPMHeader(data, size, header)){
+		return false;
+	}
+
+	ofRectangle frame(0, 0, header.width, header.height);
+	if(region != NULL && !clipRegion(*region, header.width, header.height)){
+		pixels.clear();
+		return true;
+	}
+	const ofRectangle& area = region != NULL ? *region : frame;
+
+	size_t left = area.x, top = area.y, width = area.width, height = area.height;
+
+	allocateFrame(pixels, width, height, header.channels);
+	const unsigned char* samples = (const unsigned char*)data + header.dataOffset;
+	size_t rowSamples = width * header.channels;
+	PixelType* dst = pixels.getData();
+	for(size_t y = 0; y < height; y++){
+		const unsigned char* src = samples + (((top + y) * header.width + left) * header.channels) * header.bytesPerSample;
+		if(sizeof(PixelType) == 1 && header.maxValue == 255){
+			memcpy(dst, src, rowSamples);
+		}
+		else if(header.bytesPerSample == 1){
+			for(size_t i = 0; i < rowSamples; i++){
+				dst[i] = scaleSample<PixelType>(src[i], header.maxValue);
+			}
+		}
+		else{
+			//16 bit samples are big endian
+			for(size_t i = 0; i < rowSamples; i++){
+				dst[i] = scaleSample<PixelType>((src[i * 2] << 8) | src[i * 2 + 1], header.maxValue);
+			}
+		}
+		dst += rowSamples;
+	}
+	return true;
+}
+
+bool ofxImageSequencePPMDecoder::decode(const char* data, size_t size, ofPixels& pixels)
+{
+	return decodePPM(data, size, NULL, pixels);
+}
+
+bool ofxImageSequencePPMDecoder::decode(const char* data, size_t size, ofShortPixels& pixels)
+{
+	return decodePPM(data, size, NULL, pixels);
+}
+
+bool ofxImageSequencePPMDecoder::decode(const char* data, size_t size, ofFloatPixels& pixels)
+{
+	return decodePPM(data, size, NULL, pixels);
+}
+
+template<typename PixelType>
+static bool decodePPMProxy(const char* data, size_t size, int reduction, ofPixels_<PixelType>& pixels)
+{
+	PPMHeader header;
+	if(!readPPMHeader(data, size, header) || reduction < 1){
+		return false;
+	}
+
+	size_t width = (header.width + reduction - 1) / reduction;
+	size_t height = (header.height + reduction - 1) / reduction;
+	allocateFrame(pixels, width, height, header.channels);
+	const unsigned char* samples = (const unsigned char*)data + header.dataOffset;
+	PixelType* dst = pixels.getData();
+	for(size_t y = 0; y < height; y++){
+		const unsigned char* row = samples + y * reduction * header.width * header.channels * header.bytesPerSample;
+		for(size_t x = 0; x < width; x++){
+			const unsigned char* src = row + x * reduction * header.channels * header.bytesPerSample;
+			for(size_t c = 0; c < header.channels; c++){
+				unsigned int value = header.bytesPerSample == 1 ? src[c] : (src[c * 2] << 8) | src[c * 2 + 1];
+				*dst++ = scaleSample<PixelType>(value, header.maxValue);
+			}
+		}
+	}
+	return true;
+}
+
+bool ofxImageSequencePPMDecoder::decodeProxy(const char* data, size_t size, int reduction, ofPixels& pixels)
+{
+	return decodePPMProxy(data, size, reduction, pixels);
+}
+
+bool ofxImageSequencePPMDecoder::decodeProxy(const char* data, size_t size, int reduction, ofShortPixels& pixels)
+{
+	return decodePPMProxy(data, size, reduction, pixels);
+}
+
+bool ofxImageSequencePPMDecoder::decodeProxy(const char* data, size_t size, int reduction, ofFloatPixels& pixels)
+{
+	return decodePPMProxy(data, size, reduction, pixels);
+}
+
+bool ofxImageSequencePPMDecoder::decodeRegion(const char* data, size_t size, ofRectangle& region, ofPixels& pixels)
+{
+	return decodePPM(data, size, &region, pixels);
+}
+
+bool ofxImageSequencePPMDecoder::decodeRegion(const char* data, size_t size, ofRectangle& region, ofShortPixels& pixels)
+{
+	return decodePPM(data, size, &region, pixels);
+}
+
+bool ofxImageSequencePPMDecoder::decodeRegion(const char* data, size_t size, ofRectangle& region, ofFloatPixels& pixels)
+{
+	return decodePPM(data, size, &region, pixels);
+}
+
+//--------------------------------------------------------------
+#define QOI_OP_INDEX	0x00
+#define QOI_OP_DIFF		0x40
+#define QOI_OP_LUMA		0x80
+#define QOI_OP_RUN		0xc0
+#define QOI_OP_RGB		0xfe
+#define QOI_OP_RGBA		0xff
+#define QOI_MASK_2		0xc0
+#define QOI_HEADER_SIZE	14
+#define QOI_PADDING		8
+
+static uint32_t readBigEndian32(const unsigned char* bytes)
+{
+	return (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+bool ofxImageSequenceQOIDecoder::decode(const char* data, size_t size, ofPixels& pixels)
+{
+	return decodeRows(data, size, NULL, pixels);
+}
+
+bool ofxImageSequenceQOIDecoder::decodeRegion(const char* data, size_t size, ofRectangle& region, ofPixels& pixels)
+{
+	return decodeRows(data, size, &region, pixels);
+}
+
+bool ofxImageSequenceQOIDecoder::decodeRows(const char* data, size_t size, ofRectangle* region, ofPixels& pixels)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	if(size < QOI_HEADER_SIZE + QOI_PADDING || memcmp(bytes, "qoif", 4) != 0){
+		return false;
+	}
+
+	uint32_t width = readBigEndian32(bytes + 4);
+	uint32_t height = readBigEndian32(bytes + 8);
+	size_t channels = bytes[12];
+	if(width == 0 || height == 0 || (channels != 3 && channels != 4)){
+		return false;
+	}
+
+	ofRectangle frame(0, 0, width, height);
+	if(region != NULL && !clipRegion(*region, width, height)){
+		pixels.clear();
+		return true;
+	}
+	const ofRectangle& area = region != NULL ? *region : frame;
+	size_t left = area.x, top = area.y, right = area.x + area.width, bottom = area.y + area.height;
+
+	allocateFrame(pixels, area.width, area.height, channels);
+
+	unsigned char index[64][4];
+	memset(index, 0, sizeof(index));
+	unsigned char px[4] = {0, 0, 0, 255};
+	unsigned char* dst = pixels.getData();
+	//pixels after the last row of the region don't need decoding at all
+	size_t numPixels = (size_t)width * bottom;
+	size_t pos = QOI_HEADER_SIZE;
+	size_t chunksEnd = size - QOI_PADDING;
+	int run = 0;
+	size_t x = 0, y = 0;
+
+	for(size_t i = 0; i < numPixels; i++){
+		if(run > 0){
+			run--;
+		}
+		else if(pos < chunksEnd){
+			int b1 = bytes[pos++];
+			if(b1 == QOI_OP_RGB){
+				px[0] = bytes[pos++];
+				px[1] = bytes[pos++];
+				px[2] = bytes[pos++];
+			}
+			else if(b1 == QOI_OP_RGBA){
+				px[0] = bytes[pos++];
+				px[1] = bytes[pos++];
+				px[2] = bytes[pos++];
+				px[3] = bytes[pos++];
+			}
+			else if((b1 & QOI_MASK_2) == QOI_OP_INDEX){
+				memcpy(px, index[b1], 4);
+			}
+			else if((b1 & QOI_MASK_2) == QOI_OP_DIFF){
+				px[0] += ((b1 >> 4) & 0x03) - 2;
+				px[1] += ((b1 >> 2) & 0x03) - 2;
+				px[2] += ( b1       & 0x03) - 2;
+			}
+			else if((b1 & QOI_MASK_2) == QOI_OP_LUMA){
+				int b2 = bytes[pos++];
+				int vg = (b1 & 0x3f) - 32;
+				px[0] += vg - 8 + ((b2 >> 4) & 0x0f);
+				px[1] += vg;
+				px[2] += vg - 8 +  (b2       & 0x0f);
+			}
+			else{
+				run = b1 & 0x3f;
+			}
+			memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+		}
+		else{
+			//truncated file
+			return false;
+		}
+
+		if(y >= top && x >= left && x < right){
+			memcpy(dst, px, channels);
+			dst += channels;
+		}
+		if(++x == width){
+			x = 0;
+			y++;
+		}
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+#ifdef OFX_IMAGE_SEQUENCE_USE_TURBOJPEG
+bool ofxImageSequenceTurboJpegDecoder::decode(const char* data, size_t size, ofPixels& pixels)
+{
+	return decompress(data, size, 1, pixels);
+}
+
+bool ofxImageSequenceTurboJpegDecoder::decodeProxy(const char* data, size_t size, int reduction, ofPixels& pixels)
+{
+	return decompress(data, size, reduction, pixels);
+}
+
+bool ofxImageSequenceTurboJpegDecoder::decompress(const char* data, size_t size, int reduction, ofPixels& pixels)
+{
+	//handles are cheap and can't be shared between threads decoding at the same time
+	tjhandle handle = tjInitDecompress();
+	if(handle == NULL){
+		return false;
+	}
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	int width, height, subsampling, colorspace;
+	bool decoded = false;
+	if(tjDecompressHeader3(handle, bytes, size, &width, &height, &subsampling, &colorspace) == 0 &&
+	   colorspace != TJCS_CMYK && colorspace != TJCS_YCCK){
+		size_t channels = colorspace == TJCS_GRAY ? 1 : 3;
+		tjscalingfactor scale = {1, reduction};
+		width = TJSCALED(width, scale);
+		height = TJSCALED(height, scale);
+		allocateFrame(pixels, width, height, channels);
+		decoded = tjDecompress2(handle, bytes, size, pixels.getData(), width, 0, height,
+								channels == 1 ? TJPF_GRAY : TJPF_RGB, 0) == 0;
+	}
+	tjDestroy(handle);
+	return decoded;
+}
+
+//the TurboJPEG API can't crop, regions go through the libjpeg API libjpeg-turbo also has
+struct JpegErrorManager {
+	struct jpeg_error_mgr manager;
+	jmp_buf jump;
+};
+
+static void jpegErrorExit(j_common_ptr info)
+{
+	longjmp(((JpegErrorManager*)info->err)->jump, 1);
+}
+
+//only the iMCU columns covering the region are decompressed, rows above it are skipped without the
+//inverse DCT and rows below it are not read at all
+bool ofxImageSequenceTurboJpegDecoder::decodeRegion(const char* data, size_t size, ofRectangle& region, ofPixels& pixels)
+{
+	struct jpeg_decompress_struct info;
+	JpegErrorManager error;
+	vector<unsigned char> row;
+	info.err = jpeg_std_error(&error.manager);
+	error.manager.error_exit = jpegErrorExit;
+	if(setjmp(error.jump)){
+		jpeg_destroy_decompress(&info);
+		return false;
+	}
+	jpeg_create_decompress(&info);
+	jpeg_mem_src(&info, (unsigned char*)data, size);
+	jpeg_read_header(&info, TRUE);
+	if(info.jpeg_color_space == JCS_CMYK || info.jpeg_color_space == JCS_YCCK){
+		jpeg_destroy_decompress(&info);
+		return false;
+	}
+	if(!clipRegion(region, info.image_width, info.image_height)){
+		jpeg_destroy_decompress(&info);
+		pixels.clear();
+		return true;
+	}
+
+	size_t channels = info.jpeg_color_space == JCS_GRAYSCALE ? 1 : 3;
+	info.out_color_space = channels == 1 ? JCS_GRAYSCALE : JCS_RGB;
+	jpeg_start_decompress(&info);
+
+	//chroma at the edges of a crop is upsampled without its neighbours, so the crop gets a margin of one
+	//iMCU on both sides. it is widened to whole iMCUs, xoffset and width say where it ended up
+	int margin = info.max_h_samp_factor * DCTSIZE;
+	int cropLeft = MAX((int)region.x - margin, 0);
+	int cropRight = MIN((int)(region.x + region.width) + margin, (int)info.output_width);
+	JDIMENSION xoffset = cropLeft, width = cropRight - cropLeft;
+	jpeg_crop_scanline(&info, &xoffset, &width);
+	if(region.y > 0){
+		jpeg_skip_scanlines(&info, region.y);
+	}
+
+	allocateFrame(pixels, region.width, region.height, channels);
+	row.resize(info.output_width * channels);
+	JSAMPROW rowPointer = &row[0];
+	size_t rowBytes = region.width * channels;
+	size_t skipBytes = (region.x - xoffset) * channels;
+	unsigned char* dst = pixels.getData();
+	for(int y = 0; y < region.height; y++){
+		jpeg_read_scanlines(&info, &rowPointer, 1);
+		memcpy(dst, &row[skipBytes], rowBytes);
+		dst += rowBytes;
+	}
+	jpeg_abort_decompress(&info);
+	jpeg_destroy_decompress(&info);
+	return true;
+}
+
+//JPEG has 8 bits per channel, deeper pixels convert from the 8 bit region
+template<typename PixelType>
+static bool decodeRegionAndConvert(ofxImageSequenceDecoder& decoder, const char* data, size_t size, ofRectangle& region, ofPixels_<PixelType>& pixels)
+{
+	ofPixels decoded;
+	if(!decoder.decodeRegion(data, size, region, decoded)){
+		return false;
+	}
+	pixels = decoded;
+	return true;
+}
+
+bool ofxImageSequenceTurboJpegDecoder::decodeRegion(const char* data, size_t size, ofRectangle& region, ofShortPixels& pixels)
+{
+	return decodeRegionAndConvert(*this, data, size, region, pixels);
+}
+
+bool ofxImageSequenceTurboJpegDecoder::decodeRegion(const char* data, size_t size, ofRectangle& region, ofFloatPixels& pixels)
+{
+	return decodeRegionAndConvert(*this, data, size, region, pixels);
+}
+#endif
+
+//--------------------------------------------------------------
+#ifdef OFX_IMAGE_SEQUENCE_USE_SPNG
+static bool spngHasAlpha(spng_ctx* ctx, const struct spng_ihdr& ihdr)
+{
+	struct spng_trns trns;
+	return ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE_ALPHA ||
+		   ihdr.color_type == SPNG_COLOR_TYPE_TRUECOLOR_ALPHA ||
+		   spng_get_trns(ctx, &trns) == 0;
+}
+
+bool ofxImageSequenceSpngDecoder::decode(const char* data, size_t size, ofPixels& pixels)
+{
+	spng_ctx* ctx = spng_ctx_new(0);
+	if(ctx == NULL){
+		return false;
+	}
+
+	bool decoded = false;
+	struct spng_ihdr ihdr;
+	if(spng_set_png_buffer(ctx, data, size) == 0 && spng_get_ihdr(ctx, &ihdr) == 0){
+		bool hasAlpha = spngHasAlpha(ctx, ihdr);
+		bool gray = ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE && ihdr.bit_depth <= 8 && !hasAlpha;
+
+		int format = gray ? SPNG_FMT_G8 : hasAlpha ? SPNG_FMT_RGBA8 : SPNG_FMT_RGB8;
+		size_t channels = gray ? 1 : hasAlpha ? 4 : 3;
+		size_t decodedSize;
+		if(spng_decoded_image_size(ctx, format, &decodedSize) == 0){
+			allocateFrame(pixels, ihdr.width, ihdr.height, channels);
+			decoded = decodedSize == pixels.size() &&
+					  spng_decode_image(ctx, pixels.getData(), decodedSize, format, SPNG_DECODE_TRNS) == 0;
+		}
+	}
+	spng_ctx_free(ctx);
+	return decoded;
+}
+
+//16 bit frames decode to RGBA16, the only 16 bit color format libspng has, dropping alpha again
+//for frames without it. 8 bit frames decode through the 8 bit overload and convert
+bool ofxImageSequenceSpngDecoder::decode(const char* data, size_t size, ofShortPixels& pixels)
+{
+	spng_ctx* ctx = spng_ctx_new(0);
+	if(ctx == NULL){
+		return false;
+	}
+
+	struct spng_ihdr ihdr;
+	if(spng_set_png_buffer(ctx, data, size) != 0 || spng_get_ihdr(ctx, &ihdr) != 0){
+		spng_ctx_free(ctx);
+		return false;
+	}
+	if(ihdr.bit_depth < 16){
+		spng_ctx_free(ctx);
+		return ofxImageSequenceDecoder::decode(data, size, pixels);
+	}
+
+	bool decoded = false;
+	bool hasAlpha = spngHasAlpha(ctx, ihdr);
+	bool gray = ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE && !hasAlpha;
+	size_t decodedSize;
+	if(spng_decoded_image_size(ctx, SPNG_FMT_RGBA16, &decodedSize) == 0){
+		ofShortPixels rgba;
+		ofShortPixels& target = hasAlpha ? pixels : rgba;
+		allocateFrame(target, ihdr.width, ihdr.height, 4);
+		decoded = decodedSize == target.getTotalBytes() &&
+				  spng_decode_image(ctx, target.getData(), decodedSize, SPNG_FMT_RGBA16, SPNG_DECODE_TRNS) == 0;
+		if(decoded && !hasAlpha){
+			size_t channels = gray ? 1 : 3;
+			allocateFrame(pixels, ihdr.width, ihdr.height, channels);
+			const unsigned short* src = rgba.getData();
+			unsigned short* dst = pixels.getData();
+			size_t numPixels = (size_t)ihdr.width * ihdr.height;
+			for(size_t i = 0; i < numPixels; i++){
+				memcpy(dst, src, channels * sizeof(unsigned short));
+				src += 4;
+				dst += channels;
+			}
+		}
+	}
+	spng_ctx_free(ctx);
+	return decoded;
+}
+
+bool ofxImageSequenceSpngDecoder::decode(const char* data, size_t size, ofFloatPixels& pixels)
+{
+	ofShortPixels decoded;
+	if(!decode(data, size, decoded)){
+		return false;
+	}
+	pixels = decoded;
+	return true;
+}
+
+//rows are decoded one at a time, keeping the region's columns and stopping after its last row. the rows
+//above it still decode, each PNG row is filtered against the one before. decodedChannels is the format's,
+//channels the leading ones kept
+template<typename PixelType>
+static bool decodeSpngRows(spng_ctx* ctx, const struct spng_ihdr& ihdr, int format, size_t decodedChannels, size_t channels, ofRectangle& region, ofPixels_<PixelType>& pixels)
+{
+	if(!clipRegion(region, ihdr.width, ihdr.height)){
+		pixels.clear();
+		return true;
+	}
+	size_t imageSize;
+	if(spng_decoded_image_size(ctx, format, &imageSize) != 0 ||
+	   spng_decode_image(ctx, NULL, 0, format, SPNG_DECODE_TRNS | SPNG_DECODE_PROGRESSIVE) != 0){
+		return false;
+	}
+
+	size_t rowSize = imageSize / ihdr.height;
+	vector<PixelType> row(rowSize / sizeof(PixelType));
+	allocateFrame(pixels, region.width, region.height, channels);
+	size_t left = region.x, top = region.y, bottom = region.getBottom(), width = region.width;
+	PixelType* dst = pixels.getData();
+	for(size_t y = 0; y < bottom; y++){
+		//SPNG_EOI comes with the last row
+		int status = spng_decode_row(ctx, &row[0], rowSize);
+		if(status != 0 && status != SPNG_EOI){
+			return false;
+		}
+		if(y < top){
+			continue;
+		}
+		const PixelType* src = &row[left * decodedChannels];
+		for(size_t x = 0; x < width; x++){
+			memcpy(dst, src, channels * sizeof(PixelType));
+			src += decodedChannels;
+			dst += channels;
+		}
+	}
+	return true;
+}
+
+//interlaced frames arrive in seven passes over the whole frame, there is nothing to skip
+bool ofxImageSequenceSpngDecoder::decodeRegion(const char* data, size_t size, ofRectangle& region, ofPixels& pixels)
+{
+	spng_ctx* ctx = spng_ctx_new(0);
+	if(ctx == NULL){
+		return false;
+	}
+
+	struct spng_ihdr ihdr;
+	if(spng_set_png_buffer(ctx, data, size) != 0 || spng_get_ihdr(ctx, &ihdr) != 0){
+		spng_ctx_free(ctx);
+		return false;
+	}
+	if(ihdr.interlace_method != 0){
+		spng_ctx_free(ctx);
+		return ofxImageSequenceDecoder::decodeRegion(data, size, region, pixels);
+	}
+
+	bool hasAlpha = spngHasAlpha(ctx, ihdr);
+	bool gray = ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE && ihdr.bit_depth <= 8 && !hasAlpha;
+	int format = gray ? SPNG_FMT_G8 : hasAlpha ? SPNG_FMT_RGBA8 : SPNG_FMT_RGB8;
+	size_t channels = gray ? 1 : hasAlpha ? 4 : 3;
+	bool decoded = decodeSpngRows(ctx, ihdr, format, channels, channels, region, pixels);
+	spng_ctx_free(ctx);
+	return decoded;
+}
+
+bool ofxImageSequenceSpngDecoder::decodeRegion(const char* data, size_t size, ofRectangle& region, ofShortPixels& pixels)
+{
+	spng_ctx* ctx = spng_ctx_new(0);
+	if(ctx == NULL){
+		return false;
+	}
+
+	struct spng_ihdr ihdr;
+	if(spng_set_png_buffer(ctx, data, size) != 0 || spng_get_ihdr(ctx, &ihdr) != 0){
+		spng_ctx_free(ctx);
+		return false;
+	}
+	if(ihdr.bit_depth < 16 || ihdr.interlace_method != 0){
+		spng_ctx_free(ctx);
+		ofPixels decoded;
+		if(!decodeRegion(data, size, region, decoded)){
+			return false;
+		}
+		pixels = decoded;
+		return true;
+	}
+
+	bool hasAlpha = spngHasAlpha(ctx, ihdr);
+	bool gray = ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE && !hasAlpha;
+	size_t channels = gray ? 1 : hasAlpha ? 4 : 3;
+	bool decoded = decodeSpngRows(ctx, ihdr, SPNG_FMT_RGBA16, 4, channels, region, pixels);
+	spng_ctx_free(ctx);
+	return decoded;
+}
+
+bool ofxImageSequenceSpngDecoder::decodeRegion(const char* data, size_t size, ofRectangle& region, ofFloatPixels& pixels)
+{
+	ofShortPixels decoded;
+	if(!decodeRegion(data, size, region, decoded)){
+		return false;
+	}
+	pixels = decoded;
+	return true;
+}
+#endif
@@ -0,0 +1,154 @@
+/**
+ *  ofxImageSequenceDecoder.h
+ *
+ *  Part of ofxImageSequence, see ofxImageSequence.h for license terms.
+ *
+ * ----------------------
+ *
+ *  Decoders turn the bytes of one frame file into pixels. ofxImageSequence picks one per file
+ *  extension, falling back to ofLoadImage (FreeImage) for anything without a dedicated decoder.
+ *
+ *  Decoders write into the pixels they are given. If those are already allocated with the
+ *  frame's size and channel count they are decoded into in place, so reusing frame storage
+ *  avoids an allocation per frame.
+ *
+ *  Decoders only have to implement 8 bit decoding. 16 bit and float sequences decode to 8 bit and
+ *  convert unless the decoder overrides those overloads, which it should for formats that carry
+ *  more than 8 bits per channel.
+ *
+ *  decodeProxy decodes a frame at a fraction of its size for showing while the full frame is not
+ *  ready yet. It is only worth implementing where that is much cheaper than a full decode, like JPEG
+ *  which can skip most of the DCT, the default returns false.
+ *
+ *  decodeRegion decodes part of a frame. The default decodes the whole frame and crops it, decoders
+ *  for formats that can skip rows or tiles override it so big frames cost only the region's size.
+ *
+ *  Decoders can be called from the loader thread and the main thread at the same time and
+ *  must not keep per-frame state in members.
+ *
+ *  Fast paths for libjpeg-turbo and libspng are compiled in when OFX_IMAGE_SEQUENCE_USE_TURBOJPEG
+ *  or OFX_IMAGE_SEQUENCE_USE_SPNG is defined and the libraries are linked into the project.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+
+class ofxImageSequenceDecoder {
+  public:
+	virtual ~ofxImageSequenceDecoder(){}
+
+	virtual string getName() const = 0;
+	virtual bool decode(const char* data, size_t size, ofPixels& pixels) = 0;
+	virtual bool decode(const char* data, size_t size, ofShortPixels& pixels);
+	virtual bool decode(const char* data, size_t size, ofFloatPixels& pixels);
+
+	//frames read from files come in the buffer they were read into. the default decodes its bytes,
+	//decoders for APIs that take an ofBuffer override these so the frame isn't copied into another
+	virtual bool decode(const ofBuffer& buffer, ofPixels& pixels){ return decode(buffer.getData(), buffer.size(), pixels); }
+	virtual bool decode(const ofBuffer& buffer, ofShortPixels& pixels){ return decode(buffer.getData(), buffer.size(), pixels); }
+	virtual bool decode(const ofBuffer& buffer, ofFloatPixels& pixels){ return decode(buffer.getData(), buffer.size(), pixels); }
+
+	//region is clipped to the frame and set to the area actually decoded, which is empty and leaves
+	//pixels cleared if the region lies outside the frame
+	virtual bool decodeRegion(const char* data, size_t size, ofRectangle& region, ofPixels& pixels);
+	virtual bool decodeRegion(const char* data, size_t size, ofRectangle& region, ofShortPixels& pixels);
+	virtual bool decodeRegion(const char* data, size_t size, ofRectangle& region, ofFloatPixels& pixels);
+
+	//reduction is 2, 4 or 8, the proxy is that many times smaller than the frame in each dimension, rounded up
+	virtual bool decodeProxy(const char* data, size_t size, int reduction, ofPixels& pixels){ return false; }
+	virtual bool decodeProxy(const char* data, size_t size, int reduction, ofShortPixels& pixels){ return false; }
+	virtual bool decodeProxy(const char* data, size_t size, int reduction, ofFloatPixels& pixels){ return false; }
+};
+
+//decodes through ofLoadImage, supports everything FreeImage does
+class ofxImageSequenceFreeImageDecoder : public ofxImageSequenceDecoder {
+  public:
+	using ofxImageSequenceDecoder::decodeRegion;
+	using ofxImageSequenceDecoder::decodeProxy;
+	string getName() const { return "FreeImage"; }
+	bool decode(const char* data, size_t size, ofPixels& pixels);
+	bool decode(const char* data, size_t size, ofShortPixels& pixels);
+	bool decode(const char* data, size_t size, ofFloatPixels& pixels);
+
+	//ofLoadImage reads the buffer as it is, only frames from archives are copied into one
+	bool decode(const ofBuffer& buffer, ofPixels& pixels);
+	bool decode(const ofBuffer& buffer, ofShortPixels& pixels);
+	bool decode(const ofBuffer& buffer, ofFloatPixels& pixels);
+};
+
+//binary PGM (P5) and PPM (P6), the cheapest format to decode: a short header and raw samples
+class ofxImageSequencePPMDecoder : public ofxImageSequenceDecoder {
+  public:
+	using ofxImageSequenceDecoder::decode;
+	string getName() const { return "PPM"; }
+	bool decode(const char* data, size_t size, ofPixels& pixels);
+	bool decode(const char* data, size_t size, ofShortPixels& pixels);
+	bool decode(const char* data, size_t size, ofFloatPixels& pixels);
+
+	//reads only the rows and columns of the region
+	bool decodeRegion(const char* data, size_t size, ofRectangle& region, ofPixels& pixels);
+	bool decodeRegion(const char* data, size_t size, ofRectangle& region, ofShortPixels& pixels);
+	bool decodeRegion(const char* data, size_t size, ofRectangle& region, ofFloatPixels& pixels);
+
+	//reads every reduction-th sample of every reduction-th row
+	bool decodeProxy(const char* data, size_t size, int reduction, ofPixels& pixels);
+	bool decodeProxy(const char* data, size_t size, int reduction, ofShortPixels& pixels);
+	bool decodeProxy(const char* data, size_t size, int reduction, ofFloatPixels& pixels);
+};
+
+//the Quite OK Image format, lossless and several times faster to decode than PNG
+class ofxImageSequenceQOIDecoder : public ofxImageSequenceDecoder {
+  public:
+	using ofxImageSequenceDecoder::decode;
+	using ofxImageSequenceDecoder::decodeRegion;
+	using ofxImageSequenceDecoder::decodeProxy;
+	string getName() const { return "QOI"; }
+	bool decode(const char* data, size_t size, ofPixels& pixels);
+
+	//QOI has to be decoded from the start, but only the region is stored
+	bool decodeRegion(const char* data, size_t size, ofRectangle& region, ofPixels& pixels);
+
+  protected:
+	bool decodeRows(const char* data, size_t size, ofRectangle* region, ofPixels& pixels);
+};
+
+#ifdef OFX_IMAGE_SEQUENCE_USE_TURBOJPEG
+class ofxImageSequenceTurboJpegDecoder : public ofxImageSequenceDecoder {
+  public:
+	using ofxImageSequenceDecoder::decode;
+	using ofxImageSequenceDecoder::decodeRegion;
+	using ofxImageSequenceDecoder::decodeProxy;
+	string getName() const { return "libjpeg-turbo"; }
+	bool decode(const char* data, size_t size, ofPixels& pixels);
+
+	//uses the DCT scaling of libjpeg-turbo, a quarter size proxy decodes several times faster
+	bool decodeProxy(const char* data, size_t size, int reduction, ofPixels& pixels);
+
+	//decompresses only the columns of the region and stops after its last row
+	bool decodeRegion(const char* data, size_t size, ofRectangle& region, ofPixels& pixels);
+	bool decodeRegion(const char* data, size_t size, ofRectangle& region, ofShortPixels& pixels);
+	bool decodeRegion(const char* data, size_t size, ofRectangle& region, ofFloatPixels& pixels);
+
+  protected:
+	bool decompress(const char* data, size_t size, int reduction, ofPixels& pixels);
+};
+#endif
+
+#ifdef OFX_IMAGE_SEQUENCE_USE_SPNG
+class ofxImageSequenceSpngDecoder : public ofxImageSequenceDecoder {
+  public:
+	using ofxImageSequenceDecoder::decode;
+	using ofxImageSequenceDecoder::decodeRegion;
+	using ofxImageSequenceDecoder::decodeProxy;
+	string getName() const { return "libspng"; }
+	bool decode(const char* data, size_t size, ofPixels& pixels);
+	bool decode(const char* data, size_t size, ofShortPixels& pixels);
+	bool decode(const char* data, size_t size, ofFloatPixels& pixels);
+
+	//decodes rows up to the last one of the region and keeps only its columns, whole frames if interlaced
+	bool decodeRegion(const char* data, size_t size, ofRectangle& region, ofPixels& pixels);
+	bool decodeRegion(const char* data, size_t size, ofRectangle& region, ofShortPixels& pixels);
+	bool decodeRegion(const char* data, size_t size, ofRectangle& region, ofFloatPixels& pixels);
+};
+#endif
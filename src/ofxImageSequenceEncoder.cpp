@@ -0,0 +1,211 @@
+/**
+ *  ofxImageSequenceEncoder.cpp
+ *
+ *  Part of ofxImageSequence, see ofxImageSequence.h for license terms.
+ */
+
+#include "ofxImageSequenceEncoder.h"
+
+template<typename PixelType>
+static bool convertAndEncode(ofxImageSequenceEncoder& encoder, const ofPixels_<PixelType>& pixels, ofBuffer& buffer)
+{
+	ofPixels converted(pixels);
+	return encoder.encode(converted, buffer);
+}
+
+bool ofxImageSequenceEncoder::encode(const ofShortPixels& pixels, ofBuffer& buffer)
+{
+	return convertAndEncode(*this, pixels, buffer);
+}
+
+bool ofxImageSequenceEncoder::encode(const ofFloatPixels& pixels, ofBuffer& buffer)
+{
+	return convertAndEncode(*this, pixels, buffer);
+}
+
+//--------------------------------------------------------------
+ofxImageSequenceFreeImageEncoder::ofxImageSequenceFreeImageEncoder(ofImageFormat _format, ofImageQualityType _quality)
+{
+	format = _format;
+	quality = _quality;
+}
+
+bool ofxImageSequenceFreeImageEncoder::encode(const ofPixels& pixels, ofBuffer& buffer)
+{
+	buffer.clear();
+	ofSaveImage(pixels, buffer, format, quality);
+	return buffer.size() > 0;
+}
+
+bool ofxImageSequenceFreeImageEncoder::encode(const ofShortPixels& pixels, ofBuffer& buffer)
+{
+	buffer.clear();
+	ofSaveImage(pixels, buffer, format, quality);
+	return buffer.size() > 0;
+}
+
+bool ofxImageSequenceFreeImageEncoder::encode(const ofFloatPixels& pixels, ofBuffer& buffer)
+{
+	buffer.clear();
+	ofSaveImage(pixels, buffer, format, quality);
+	return buffer.size() > 0;
+}
+
+//--------------------------------------------------------------
+//samples are written as they are, 16 bit ones big endian. a fourth channel is skipped
+template<typename PixelType>
+static bool encodePPM(const ofPixels_<PixelType>& pixels, unsigned int maxValue, ofBuffer& buffer)
+{
+	size_t width = pixels.getWidth(), height = pixels.getHeight(), channels = pixels.getNumChannels();
+	if(!pixels.isAllocated() || (channels != 1 && channels != 3 && channels != 4)){
+		return false;
+	}
+
+	size_t outChannels = channels == 1 ? 1 : 3;
+	size_t bytesPerSample = maxValue > 255 ? 2 : 1;
+	char header[64];
+	int headerSize = snprintf(header, sizeof(header), "P%c\n%d %d\n%u\n", outChannels == 1 ? '5' : '6', (int)width, (int)height, maxValue);
+	size_t numPixels = width * height;
+
+	vector<char> data(headerSize + numPixels * outChannels * bytesPerSample);
+	memcpy(&data[0], header, headerSize);
+	unsigned char* dst = (unsigned char*)&data[headerSize];
+	const PixelType* src = pixels.getData();
+	for(size_t i = 0; i < numPixels; i++){
+		for(size_t c = 0; c < outChannels; c++){
+			unsigned int value = src[c];
+			if(bytesPerSample == 2){
+				*dst++ = value >> 8;
+			}
+			*dst++ = value & 0xff;
+		}
+		src += channels;
+	}
+	buffer.set(&data[0], data.size());
+	return true;
+}
+
+bool ofxImageSequencePPMEncoder::encode(const ofPixels& pixels, ofBuffer& buffer)
+{
+	return encodePPM(pixels, 255, buffer);
+}
+
+bool ofxImageSequencePPMEncoder::encode(const ofShortPixels& pixels, ofBuffer& buffer)
+{
+	return encodePPM(pixels, 65535, buffer);
+}
+
+bool ofxImageSequencePPMEncoder::encode(const ofFloatPixels& pixels, ofBuffer& buffer)
+{
+	ofShortPixels converted(pixels);
+	return encodePPM(converted, 65535, buffer);
+}
+
+//--------------------------------------------------------------
+#define QOI_OP_INDEX	0x00
+#define QOI_OP_DIFF		0x40
+#define QOI_OP_LUMA		0x80
+#define QOI_OP_RUN		0xc0
+#define QOI_OP_RGB		0xfe
+#define QOI_OP_RGBA		0xff
+#define QOI_HEADER_SIZE	14
+#define QOI_PADDING		8
+
+static void writeBigEndian32(unsigned char* bytes, uint32_t value)
+{
+	bytes[0] = value >> 24;
+	bytes[1] = value >> 16;
+	bytes[2] = value >> 8;
+	bytes[3] = value;
+}
+
+bool ofxImageSequenceQOIEncoder::encode(const ofPixels& pixels, ofBuffer& buffer)
+{
+	size_t width = pixels.getWidth(), height = pixels.getHeight(), channels = pixels.getNumChannels();
+	if(!pixels.isAllocated() || (channels != 1 && channels != 3 && channels != 4)){
+		return false;
+	}
+
+	size_t outChannels = channels == 4 ? 4 : 3;
+	size_t numPixels = width * height;
+	//worst case is one tag byte more than the samples for every pixel
+	vector<unsigned char> data(QOI_HEADER_SIZE + numPixels * (outChannels + 1) + QOI_PADDING);
+	unsigned char* bytes = &data[0];
+	memcpy(bytes, "qoif", 4);
+	writeBigEndian32(bytes + 4, width);
+	writeBigEndian32(bytes + 8, height);
+	bytes[12] = outChannels;
+	bytes[13] = 0;
+
+	unsigned char index[64][4];
+	memset(index, 0, sizeof(index));
+	unsigned char previous[4] = {0, 0, 0, 255};
+	unsigned char px[4] = {0, 0, 0, 255};
+	const unsigned char* src = pixels.getData();
+	size_t pos = QOI_HEADER_SIZE;
+	int run = 0;
+
+	for(size_t i = 0; i < numPixels; i++){
+		if(channels == 1){
+			px[0] = px[1] = px[2] = src[0];
+		}
+		else{
+			memcpy(px, src, channels);
+		}
+		src += channels;
+
+		if(memcmp(px, previous, 4) == 0){
+			run++;
+			if(run == 62 || i == numPixels - 1){
+				bytes[pos++] = QOI_OP_RUN | (run - 1);
+				run = 0;
+			}
+			continue;
+		}
+		if(run > 0){
+			bytes[pos++] = QOI_OP_RUN | (run - 1);
+			run = 0;
+		}
+
+		int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+		if(memcmp(index[hash], px, 4) == 0){
+			bytes[pos++] = QOI_OP_INDEX | hash;
+		}
+		else{
+			memcpy(index[hash], px, 4);
+			if(px[3] == previous[3]){
+				signed char vr = px[0] - previous[0];
+				signed char vg = px[1] - previous[1];
+				signed char vb = px[2] - previous[2];
+				signed char vgr = vr - vg;
+				signed char vgb = vb - vg;
+				if(vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2){
+					bytes[pos++] = QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+				}
+				else if(vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8){
+					bytes[pos++] = QOI_OP_LUMA | (vg + 32);
+					bytes[pos++] = (vgr + 8) << 4 | (vgb + 8);
+				}
+				else{
+					bytes[pos++] = QOI_OP_RGB;
+					bytes[pos++] = px[0];
+					bytes[pos++] = px[1];
+					bytes[pos++] = px[2];
+				}
+			}
+			else{
+				bytes[pos++] = QOI_OP_RGBA;
+				memcpy(bytes + pos, px, 4);
+				pos += 4;
+			}
+		}
+		memcpy(previous, px, 4);
+	}
+
+	//seven zero bytes and a one mark the end of the stream
+	memset(bytes + pos, 0, QOI_PADDING - 1);
+	pos += QOI_PADDING - 1;
+	bytes[pos++] = 1;
+	buffer.set((const char*)bytes, pos);
+	return true;
+}
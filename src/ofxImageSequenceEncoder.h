@@ -0,0 +1,62 @@
+/**
+ *  ofxImageSequenceEncoder.h
+ *
+ *  Part of ofxImageSequence, see ofxImageSequence.h for license terms.
+ *
+ * ----------------------
+ *
+ *  Encoders turn pixels into the bytes of one frame file, the other way around from decoders.
+ *  ofxImageSequenceExporter picks one per file extension.
+ *
+ *  Encoders only have to implement 8 bit encoding. 16 bit and float frames are converted to 8 bit
+ *  unless the encoder overrides those overloads, which it should for formats that can store more.
+ *
+ *  Encoders are called from several exporter threads at the same time and must not keep per-frame
+ *  state in members.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+
+class ofxImageSequenceEncoder {
+  public:
+	virtual ~ofxImageSequenceEncoder(){}
+
+	virtual string getName() const = 0;
+	virtual bool encode(const ofPixels& pixels, ofBuffer& buffer) = 0;
+	virtual bool encode(const ofShortPixels& pixels, ofBuffer& buffer);
+	virtual bool encode(const ofFloatPixels& pixels, ofBuffer& buffer);
+};
+
+//encodes through ofSaveImage, supports everything FreeImage can write
+class ofxImageSequenceFreeImageEncoder : public ofxImageSequenceEncoder {
+  public:
+	ofxImageSequenceFreeImageEncoder(ofImageFormat format, ofImageQualityType quality = OF_IMAGE_QUALITY_BEST);
+	string getName() const { return "FreeImage"; }
+	bool encode(const ofPixels& pixels, ofBuffer& buffer);
+	bool encode(const ofShortPixels& pixels, ofBuffer& buffer);
+	bool encode(const ofFloatPixels& pixels, ofBuffer& buffer);
+
+  protected:
+	ofImageFormat format;
+	ofImageQualityType quality;
+};
+
+//binary PGM (P5) for one channel and PPM (P6) for the rest, dropping alpha. 16 bit and float
+//frames are written with 16 bit samples
+class ofxImageSequencePPMEncoder : public ofxImageSequenceEncoder {
+  public:
+	string getName() const { return "PPM"; }
+	bool encode(const ofPixels& pixels, ofBuffer& buffer);
+	bool encode(const ofShortPixels& pixels, ofBuffer& buffer);
+	bool encode(const ofFloatPixels& pixels, ofBuffer& buffer);
+};
+
+//the Quite OK Image format, RGB or RGBA. grayscale frames are written as RGB
+class ofxImageSequenceQOIEncoder : public ofxImageSequenceEncoder {
+  public:
+	using ofxImageSequenceEncoder::encode;
+	string getName() const { return "QOI"; }
+	bool encode(const ofPixels& pixels, ofBuffer& buffer);
+};
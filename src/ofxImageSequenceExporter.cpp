@@ -0,0 +1,500 @@
+/**
+ *  ofxImageSequenceExporter.cpp
+ *
+ *  Part of ofxImageSequence, see ofxImageSequence.h for license terms.
+ */
+
+#include "ofxImageSequenceExporter.h"
+
+template<typename PixelType>
+class ofxImageSequenceExportWorker_ : public ofThread
+{
+  public:
+	ofxImageSequenceExporter_<PixelType>& exporterRef;
+	bool decoder;
+
+	ofxImageSequenceExportWorker_(ofxImageSequenceExporter_<PixelType>* exporter, bool _decoder)
+	: exporterRef(*exporter)
+	{
+		decoder = _decoder;
+		startThread(true);
+	}
+
+	~ofxImageSequenceExportWorker_(){
+		waitForThread(true);
+	}
+
+	void threadedFunction(){
+		ofBuffer buffer;
+		int frame;
+		ofPixels_<PixelType>* pixels;
+		if(decoder){
+			while(isThreadRunning() && exporterRef.startDecode(frame)){
+				pixels = new ofPixels_<PixelType>();
+				if(!exporterRef.readFrame(frame, *pixels, buffer)){
+					delete pixels;
+					pixels = NULL;
+				}
+				exporterRef.finishDecode(frame, pixels);
+			}
+		}
+		else{
+			while(isThreadRunning() && exporterRef.startEncode(frame, pixels)){
+				exporterRef.writeFrame(frame, *pixels, buffer);
+				exporterRef.finishEncode(frame, pixels, buffer);
+			}
+		}
+		exporterRef.workerDone(decoder);
+	}
+};
+
+template<typename PixelType>
+ofxImageSequenceExporter_<PixelType>::ofxImageSequenceExporter_()
+{
+	numDecodeWorkers = MAX((int)thread::hardware_concurrency() / 2, 1);
+	numEncodeWorkers = numDecodeWorkers;
+	queueSize = 8;
+	maxMemory = 512 * 1024 * 1024;
+	maxFrameRate = 0;
+	width = 0;
+	height = 0;
+	numChannels = 0;
+	sequence = NULL;
+	startIndex = 0;
+	numDigits = 0;
+	numFrames = 0;
+	nextFrame = 0;
+	decodersRunning = 0;
+	cancelled = false;
+	frameEstimate = 0;
+	memoryInFlight = 0;
+	peakMemory = 0;
+	workersRunning = 0;
+	framesExported = 0;
+	framesFailed = 0;
+	bytesWritten = 0;
+	decodeWaitMicros = 0;
+	encodeWaitMicros = 0;
+	startTime = 0;
+	endTime = 0;
+
+	shared_ptr<ofxImageSequenceEncoder> ppmEncoder(new ofxImageSequencePPMEncoder());
+	setEncoder("ppm", ppmEncoder);
+	setEncoder("pgm", ppmEncoder);
+	setEncoder("qoi", shared_ptr<ofxImageSequenceEncoder>(new ofxImageSequenceQOIEncoder()));
+	setEncoder("png", shared_ptr<ofxImageSequenceEncoder>(new ofxImageSequenceFreeImageEncoder(OF_IMAGE_FORMAT_PNG)));
+	shared_ptr<ofxImageSequenceEncoder> jpegEncoder(new ofxImageSequenceFreeImageEncoder(OF_IMAGE_FORMAT_JPEG));
+	setEncoder("jpg", jpegEncoder);
+	setEncoder("jpeg", jpegEncoder);
+	shared_ptr<ofxImageSequenceEncoder> tiffEncoder(new ofxImageSequenceFreeImageEncoder(OF_IMAGE_FORMAT_TIFF));
+	setEncoder("tif", tiffEncoder);
+	setEncoder("tiff", tiffEncoder);
+	setEncoder("bmp", shared_ptr<ofxImageSequenceEncoder>(new ofxImageSequenceFreeImageEncoder(OF_IMAGE_FORMAT_BMP)));
+	setEncoder("tga", shared_ptr<ofxImageSequenceEncoder>(new ofxImageSequenceFreeImageEncoder(OF_IMAGE_FORMAT_TARGA)));
+	setEncoder("exr", shared_ptr<ofxImageSequenceEncoder>(new ofxImageSequenceFreeImageEncoder(OF_IMAGE_FORMAT_EXR)));
+}
+
+template<typename PixelType>
+ofxImageSequenceExporter_<PixelType>::~ofxImageSequenceExporter_()
+{
+	cancelExport();
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::setEncoder(string ext, shared_ptr<ofxImageSequenceEncoder> encoder)
+{
+	if(isExporting()){
+		ofLogError("ofxImageSequenceExporter::setEncoder") << "Encoders can't be changed while exporting";
+		return;
+	}
+	if(encoder){
+		encoders[ofToLower(ext)] = encoder;
+	}
+	else{
+		encoders.erase(ofToLower(ext));
+	}
+}
+
+template<typename PixelType>
+shared_ptr<ofxImageSequenceEncoder> ofxImageSequenceExporter_<PixelType>::getEncoder(string ext) const
+{
+	map<string, shared_ptr<ofxImageSequenceEncoder> >::const_iterator encoder = encoders.find(ofToLower(ext));
+	if(encoder != encoders.end()){
+		return encoder->second;
+	}
+	return shared_ptr<ofxImageSequenceEncoder>();
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::setNumWorkers(int decodeWorkers, int encodeWorkers)
+{
+	numDecodeWorkers = MAX(decodeWorkers, 1);
+	numEncodeWorkers = MAX(encodeWorkers, 1);
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::setQueueSize(int frames)
+{
+	ofScopedLock lock(mutex);
+	queueSize = MAX(frames, 1);
+	queueChanged.notify_all();
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::setMaxMemory(uint64_t bytes)
+{
+	ofScopedLock lock(mutex);
+	maxMemory = bytes;
+	queueChanged.notify_all();
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::setMaxFrameRate(float rate)
+{
+	ofScopedLock lock(mutex);
+	maxFrameRate = MAX(rate, 0);
+	queueChanged.notify_all();
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::setSize(int _width, int _height)
+{
+	if(isExporting()){
+		ofLogError("ofxImageSequenceExporter::setSize") << "The size can't be changed while exporting";
+		return;
+	}
+	width = MAX(_width, 0);
+	height = MAX(_height, 0);
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::setNumChannels(int channels)
+{
+	if(isExporting()){
+		ofLogError("ofxImageSequenceExporter::setNumChannels") << "Channels can't be changed while exporting";
+		return;
+	}
+	if(channels != 0 && channels != 1 && channels != 3 && channels != 4){
+		ofLogError("ofxImageSequenceExporter::setNumChannels") << "Frames can only be exported with 1, 3 or 4 channels";
+		return;
+	}
+	numChannels = channels;
+}
+
+template<typename PixelType>
+bool ofxImageSequenceExporter_<PixelType>::exportSequence(ofxImageSequence_<PixelType>& _sequence, string _prefix, string filetype, int _startIndex, int _numDigits)
+{
+	if(isExporting()){
+		ofLogError("ofxImageSequenceExporter::exportSequence") << "An export is already running";
+		return false;
+	}
+	if(!_sequence.isLoaded() || _sequence.isLoading()){
+		ofLogError("ofxImageSequenceExporter::exportSequence") << "Sequences need to be loaded, without a threaded load running, before exporting them";
+		return false;
+	}
+	encoder = getEncoder(filetype);
+	if(!encoder){
+		ofLogError("ofxImageSequenceExporter::exportSequence") << "No encoder for " << filetype << " files";
+		return false;
+	}
+
+	string folder = ofFilePath::getEnclosingDirectory(ofToDataPath(_prefix), false);
+	if(folder != "" && !ofDirectory::doesDirectoryExist(folder, false) && !ofDirectory::createDirectory(folder, false, true)){
+		ofLogError("ofxImageSequenceExporter::exportSequence") << "Couldn't create " << folder;
+		return false;
+	}
+
+	stopWorkers();
+	sequence = &_sequence;
+	prefix = _prefix;
+	suffix = "." + filetype;
+	startIndex = _startIndex;
+	numDigits = _numDigits;
+	numFrames = sequence->getTotalFrames();
+	nextFrame = 0;
+	decodersRunning = numDecodeWorkers;
+	cancelled = false;
+	frameEstimate = 0;
+	memoryInFlight = 0;
+	peakMemory = 0;
+	framesExported = 0;
+	framesFailed = 0;
+	bytesWritten = 0;
+	decodeWaitMicros = 0;
+	encodeWaitMicros = 0;
+	startTime = ofGetElapsedTimeMicros();
+	endTime = 0;
+
+	//the last decode worker to finish unlocks it
+	sequence->lockFrameList();
+	workersRunning = numDecodeWorkers + numEncodeWorkers;
+	for(int i = 0; i < numDecodeWorkers; i++){
+		workers.push_back(new ofxImageSequenceExportWorker_<PixelType>(this, true));
+	}
+	for(int i = 0; i < numEncodeWorkers; i++){
+		workers.push_back(new ofxImageSequenceExportWorker_<PixelType>(this, false));
+	}
+	return true;
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::cancelExport()
+{
+	mutex.lock();
+	cancelled = true;
+	queueChanged.notify_all();
+	mutex.unlock();
+	stopWorkers();
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::waitForExport()
+{
+	for(int i = 0; i < workers.size(); i++){
+		workers[i]->waitForThread(false);
+	}
+	stopWorkers();
+}
+
+template<typename PixelType>
+bool ofxImageSequenceExporter_<PixelType>::isExporting() const
+{
+	return workersRunning > 0;
+}
+
+template<typename PixelType>
+float ofxImageSequenceExporter_<PixelType>::getProgress() const
+{
+	if(numFrames == 0){
+		return 0;
+	}
+	return 1.0 * (framesExported + framesFailed) / numFrames;
+}
+
+template<typename PixelType>
+ofxImageSequenceExportStats ofxImageSequenceExporter_<PixelType>::getStats() const
+{
+	ofxImageSequenceExportStats stats;
+	stats.framesExported = framesExported;
+	stats.framesFailed = framesFailed;
+	stats.bytesWritten = bytesWritten;
+	stats.elapsedMicros = startTime == 0 ? 0 : (endTime > 0 ? endTime.load() : ofGetElapsedTimeMicros()) - startTime;
+	stats.framesPerSecond = stats.elapsedMicros > 0 ? stats.framesExported * 1000000.0 / stats.elapsedMicros : 0;
+	mutex.lock();
+	stats.memoryInFlight = memoryInFlight;
+	stats.peakMemory = peakMemory;
+	mutex.unlock();
+	stats.decodeWaitMicros = decodeWaitMicros;
+	stats.encodeWaitMicros = encodeWaitMicros;
+	return stats;
+}
+
+//hands out the next frame once the queue, counting frames still being decoded, and the memory limit have
+//room for it. memory for a frame is reserved at its largest size so far before it is decoded
+template<typename PixelType>
+bool ofxImageSequenceExporter_<PixelType>::startDecode(int& frame)
+{
+	ofScopedLock lock(mutex);
+	uint64_t waitStart = ofGetElapsedTimeMicros();
+	while(!cancelled && nextFrame < numFrames){
+		//until a frame has been decoded its size is unknown and reserves nothing, so only one is started
+		bool full = queue.size() >= queueSize || (frameEstimate == 0 && !queue.empty()) ||
+					(memoryInFlight > 0 && memoryInFlight + frameEstimate > maxMemory);
+		uint64_t due = maxFrameRate > 0 ? startTime + nextFrame * 1000000.0 / maxFrameRate : 0;
+		uint64_t now = ofGetElapsedTimeMicros();
+		if(!full && now >= due){
+			break;
+		}
+		if(full){
+			queueChanged.wait(lock);
+		}
+		else{
+			queueChanged.wait_for(lock, chrono::microseconds(due - now));
+		}
+	}
+	decodeWaitMicros += ofGetElapsedTimeMicros() - waitStart;
+	if(cancelled || nextFrame >= numFrames){
+		return false;
+	}
+
+	frame = nextFrame++;
+	addMemory(frameEstimate);
+	//a decoded frame is queued when it is done, keep its place in the queue until then
+	queue.push_back(QueuedFrame());
+	queue.back().frame = frame;
+	queue.back().pixels = NULL;
+	queue.back().reserved = frameEstimate;
+	return true;
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::finishDecode(int frame, ofPixels_<PixelType>* pixels)
+{
+	ofScopedLock lock(mutex);
+	typename deque<QueuedFrame>::iterator queued = queue.begin();
+	while(queued->frame != frame){
+		queued++;
+	}
+	removeMemory(queued->reserved);
+	if(pixels == NULL){
+		queue.erase(queued);
+		framesFailed++;
+	}
+	else{
+		uint64_t size = pixels->size() * sizeof(PixelType);
+		frameEstimate = MAX(frameEstimate, size);
+		addMemory(size);
+		queued->pixels = pixels;
+	}
+	queueChanged.notify_all();
+}
+
+//encoders take any decoded frame, frames don't have to be written in order
+template<typename PixelType>
+bool ofxImageSequenceExporter_<PixelType>::startEncode(int& frame, ofPixels_<PixelType>*& pixels)
+{
+	ofScopedLock lock(mutex);
+	uint64_t waitStart = ofGetElapsedTimeMicros();
+	typename deque<QueuedFrame>::iterator queued;
+	while(!cancelled){
+		for(queued = queue.begin(); queued != queue.end() && queued->pixels == NULL; queued++);
+		if(queued != queue.end() || (queue.size() == 0 && decodersRunning == 0)){
+			break;
+		}
+		queueChanged.wait(lock);
+	}
+	encodeWaitMicros += ofGetElapsedTimeMicros() - waitStart;
+	if(cancelled || queued == queue.end()){
+		return false;
+	}
+
+	frame = queued->frame;
+	pixels = queued->pixels;
+	queue.erase(queued);
+	queueChanged.notify_all();
+	return true;
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::finishEncode(int frame, ofPixels_<PixelType>* pixels, ofBuffer& buffer)
+{
+	ofScopedLock lock(mutex);
+	removeMemory(pixels->size() * sizeof(PixelType) + buffer.size());
+	delete pixels;
+	buffer.clear();
+	queueChanged.notify_all();
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::workerDone(bool decoder)
+{
+	ofScopedLock lock(mutex);
+	if(decoder && --decodersRunning == 0){
+		sequence->unlockFrameList();
+	}
+	if(--workersRunning == 0){
+		endTime = ofGetElapsedTimeMicros();
+	}
+	queueChanged.notify_all();
+}
+
+template<typename PixelType>
+bool ofxImageSequenceExporter_<PixelType>::readFrame(int frame, ofPixels_<PixelType>& pixels, ofBuffer& buffer)
+{
+	if(!sequence->decodeFramePixels(frame, pixels, buffer)){
+		return false;
+	}
+
+	if(numChannels > 0 && pixels.getNumChannels() != numChannels){
+		pixels.setNumChannels(numChannels);
+	}
+
+	int targetWidth = width, targetHeight = height;
+	if(targetWidth == 0 && targetHeight == 0){
+		return true;
+	}
+	if(targetWidth == 0){
+		targetWidth = MAX(1, (int)round(pixels.getWidth() * targetHeight / (float)pixels.getHeight()));
+	}
+	else if(targetHeight == 0){
+		targetHeight = MAX(1, (int)round(pixels.getHeight() * targetWidth / (float)pixels.getWidth()));
+	}
+	if(targetWidth != pixels.getWidth() || targetHeight != pixels.getHeight()){
+		ofPixels_<PixelType> resized;
+		resized.allocate(targetWidth, targetHeight, pixels.getNumChannels());
+		pixels.resizeTo(resized, OF_INTERPOLATE_BICUBIC);
+		pixels.swap(resized);
+	}
+	return true;
+}
+
+template<typename PixelType>
+bool ofxImageSequenceExporter_<PixelType>::writeFrame(int frame, const ofPixels_<PixelType>& pixels, ofBuffer& buffer)
+{
+	char digits[32];
+	snprintf(digits, sizeof(digits), "%0*d", numDigits, startIndex + frame);
+	string path = prefix + digits + suffix;
+
+	if(!encoder->encode(pixels, buffer)){
+		ofLogError("ofxImageSequenceExporter::writeFrame") << encoder->getName() << " couldn't encode " << path;
+		buffer.clear();
+		framesFailed++;
+		return false;
+	}
+	mutex.lock();
+	addMemory(buffer.size());
+	mutex.unlock();
+
+	FILE* file = fopen(ofToDataPath(path).c_str(), "wb");
+	bool written = file != NULL && fwrite(buffer.getData(), 1, buffer.size(), file) == buffer.size();
+	if(file != NULL && fclose(file) != 0){
+		written = false;
+	}
+	if(!written){
+		ofLogError("ofxImageSequenceExporter::writeFrame") << "Couldn't write " << path;
+		framesFailed++;
+		return false;
+	}
+	bytesWritten += buffer.size();
+	framesExported++;
+	return true;
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::stopWorkers()
+{
+	for(int i = 0; i < workers.size(); i++){
+		workers[i]->stopThread();
+	}
+	mutex.lock();
+	queueChanged.notify_all();
+	mutex.unlock();
+	for(int i = 0; i < workers.size(); i++){
+		delete workers[i];
+	}
+	workers.clear();
+
+	for(int i = 0; i < queue.size(); i++){
+		delete queue[i].pixels;
+	}
+	queue.clear();
+	memoryInFlight = 0;
+}
+
+//called with the mutex held
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::addMemory(uint64_t bytes)
+{
+	memoryInFlight += bytes;
+	peakMemory = MAX(peakMemory, memoryInFlight);
+}
+
+template<typename PixelType>
+void ofxImageSequenceExporter_<PixelType>::removeMemory(uint64_t bytes)
+{
+	memoryInFlight -= MIN(memoryInFlight, bytes);
+}
+
+template class ofxImageSequenceExporter_<unsigned char>;
+template class ofxImageSequenceExporter_<unsigned short>;
+template class ofxImageSequenceExporter_<float>;
@@ -0,0 +1,140 @@
+/**
+ *  ofxImageSequenceExporter.h
+ *
+ *  Part of ofxImageSequence, see ofxImageSequence.h for license terms.
+ *
+ * ----------------------
+ *
+ *  Writes a loaded sequence out as a new one, optionally resized or with a different channel count,
+ *  in any format there is an encoder for. Use it to convert sequences to a format that is faster to
+ *  load, like QOI, without a separate tool reading every frame again.
+ *
+ *  Frames are read and decoded through the sequence, so a region of interest set on it crops the
+ *  export. They are not kept in the sequence's memory. Decode workers read, decode and resize frames
+ *  into a queue, encode workers take them from it, encode them and write the files. When the queue is
+ *  full or the frames in flight reach the memory limit the decode workers wait for the encoders, so
+ *  memory stays bounded however slow encoding is.
+ *
+ *  Exports run in the background. Until every frame is decoded the sequence refuses changes to its
+ *  frames, like loading, rescanning, a region of interest or alpha trim, and its folder watch holds
+ *  rescans. Don't unload or delete the sequence until the export is done or cancelled.
+ */
+
+#pragma once
+
+#include "ofxImageSequence.h"
+#include "ofxImageSequenceEncoder.h"
+#include <condition_variable>
+
+struct ofxImageSequenceExportStats {
+	uint64_t framesExported;
+	uint64_t framesFailed;
+	uint64_t bytesWritten;
+	uint64_t elapsedMicros;
+	float framesPerSecond;
+	uint64_t memoryInFlight;		//decoded and encoded frames between reading and writing
+	uint64_t peakMemory;			//the highest memoryInFlight reached
+	uint64_t decodeWaitMicros;		//time decode workers waited for room in the queue, high when encoding is the bottleneck
+	uint64_t encodeWaitMicros;		//time encode workers waited for frames, high when decoding is the bottleneck
+};
+
+template<typename PixelType>
+class ofxImageSequenceExportWorker_;
+
+template<typename PixelType>
+class ofxImageSequenceExporter_ {
+  public:
+	ofxImageSequenceExporter_();
+	~ofxImageSequenceExporter_();
+
+	//sets the encoder used for files with an extension, like "qoi". call before exporting
+	void setEncoder(string extension, shared_ptr<ofxImageSequenceEncoder> encoder);
+	shared_ptr<ofxImageSequenceEncoder> getEncoder(string extension) const;
+
+	void setNumWorkers(int decodeWorkers, int encodeWorkers);	//default is half the cores each
+	void setQueueSize(int frames);				//frames being decoded or waiting for an encoder, default 8
+	void setMaxMemory(uint64_t bytes);			//frames in flight, default 512MB. one frame is always let through
+	void setMaxFrameRate(float rate);			//0 exports as fast as possible, the default
+	void setSize(int width, int height);		//0 for both keeps the size, 0 for one keeps the aspect ratio
+	void setNumChannels(int channels);			//1, 3 or 4, 0 keeps the frames' channels
+
+	/**
+	 *	writes the sequence as files named like loadSequence expects them:
+	 *	prefix + index padded to numDigits + "." + filetype
+	 *
+	 *	exportSequence(sequence, "converted/frame", "qoi", 0, 4) writes
+	 *	converted/frame0000.qoi, converted/frame0001.qoi ...
+	 *
+	 *	the folder is created if needed. returns false if the export couldn't start
+	 */
+	bool exportSequence(ofxImageSequence_<PixelType>& sequence, string prefix, string filetype, int startIndex = 0, int numDigits = 0);
+
+	void cancelExport();
+	void waitForExport();						//blocks until every frame is written
+	bool isExporting() const;
+	float getProgress() const;					//0 to 1
+	ofxImageSequenceExportStats getStats() const;
+
+	//Do not call directly
+	//called internally from the export workers
+	bool startDecode(int& frame);
+	void finishDecode(int frame, ofPixels_<PixelType>* pixels);
+	bool startEncode(int& frame, ofPixels_<PixelType>*& pixels);
+	void finishEncode(int frame, ofPixels_<PixelType>* pixels, ofBuffer& buffer);
+	void workerDone(bool decoder);
+	bool readFrame(int frame, ofPixels_<PixelType>& pixels, ofBuffer& buffer);
+	bool writeFrame(int frame, const ofPixels_<PixelType>& pixels, ofBuffer& buffer);
+
+  protected:
+	struct QueuedFrame {
+		int frame;
+		ofPixels_<PixelType>* pixels;	//NULL while the frame is being decoded
+		uint64_t reserved;
+	};
+
+	void stopWorkers();
+	void addMemory(uint64_t bytes);
+	void removeMemory(uint64_t bytes);
+
+	map<string, shared_ptr<ofxImageSequenceEncoder> > encoders;
+	shared_ptr<ofxImageSequenceEncoder> encoder;
+	vector<ofxImageSequenceExportWorker_<PixelType>*> workers;
+	int numDecodeWorkers;
+	int numEncodeWorkers;
+	int queueSize;
+	uint64_t maxMemory;
+	float maxFrameRate;
+	int width, height;
+	int numChannels;
+
+	ofxImageSequence_<PixelType>* sequence;
+	string prefix;
+	string suffix;
+	int startIndex;
+	int numDigits;
+	int numFrames;
+
+	//frames are queued in order when a decoder starts on them, encoders take them once they are decoded
+	deque<QueuedFrame> queue;
+	int nextFrame;
+	int decodersRunning;
+	bool cancelled;
+	uint64_t frameEstimate;		//memory reserved for a frame before it is decoded, the largest seen so far
+	uint64_t memoryInFlight;
+	uint64_t peakMemory;
+	mutable ofMutex mutex;
+	condition_variable queueChanged;
+
+	atomic<int> workersRunning;
+	atomic<uint64_t> framesExported;
+	atomic<uint64_t> framesFailed;
+	atomic<uint64_t> bytesWritten;
+	atomic<uint64_t> decodeWaitMicros;
+	atomic<uint64_t> encodeWaitMicros;
+	uint64_t startTime;
+	atomic<uint64_t> endTime;
+};
+
+typedef ofxImageSequenceExporter_<unsigned char> ofxImageSequenceExporter;
+typedef ofxImageSequenceExporter_<unsigned short> ofxShortImageSequenceExporter;
+typedef ofxImageSequenceExporter_<float> ofxFloatImageSequenceExporter;
@@ -0,0 +1,392 @@
+/**
+ *  ofxImageSequenceGroup.cpp
+ *
+ *  Part of ofxImageSequence, see ofxImageSequence.h for license terms.
+ */
+
+#include "ofxImageSequenceGroup.h"
+
+//how long an idle worker waits before looking for work again if nothing wakes it
+#define OFX_IMAGE_SEQUENCE_GROUP_IDLE_MILLIS 10
+
+template<typename PixelType>
+class ofxImageSequenceGroupWorker_ : public ofThread
+{
+  public:
+	ofxImageSequenceGroup_<PixelType>& groupRef;
+
+	ofxImageSequenceGroupWorker_(ofxImageSequenceGroup_<PixelType>* group)
+	: groupRef(*group)
+	{
+		startThread(true);
+	}
+
+	~ofxImageSequenceGroupWorker_(){
+		waitForThread(true);
+	}
+
+	void threadedFunction(){
+		ofBuffer buffer;
+		ofxImageSequence_<PixelType>* sequence;
+		int frame;
+		while(isThreadRunning()){
+			if(groupRef.getNextJob(sequence, frame)){
+				sequence->decodeFrame(frame, buffer);
+			}
+		}
+	}
+};
+
+template<typename PixelType>
+ofxImageSequenceGroup_<PixelType>::ofxImageSequenceGroup_()
+{
+	numWorkers = MAX((int)thread::hardware_concurrency() - 1, 1);
+	lookAheadFrames = 8;
+	frameRate = 30.0f;
+	loop = true;
+	playing = false;
+	playStartTime = 0;
+	playStartFrame = 0;
+	targetFrame = 0;
+	presentedFrame = -1;
+	nextLayer = 0;
+	stoppingWorkers = false;
+	resetStats();
+	ofAddListener(ofEvents().update, this, &ofxImageSequenceGroup_<PixelType>::update);
+}
+
+template<typename PixelType>
+ofxImageSequenceGroup_<PixelType>::~ofxImageSequenceGroup_()
+{
+	ofRemoveListener(ofEvents().update, this, &ofxImageSequenceGroup_<PixelType>::update);
+	clear();
+}
+
+//workers are stopped while layers change so none of them is decoding into a sequence being removed
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::addSequence(ofxImageSequence_<PixelType>* sequence)
+{
+	if(sequence == NULL || find(layers.begin(), layers.end(), sequence) != layers.end()){
+		return;
+	}
+	if(!sequence->isLoaded() || sequence->isLoading()){
+		ofLogError("ofxImageSequenceGroup::addSequence") << "Sequences need to be loaded, without a threaded load, before adding them";
+		return;
+	}
+
+	stopWorkers();
+	sequence->lockFrameList();
+	layers.push_back(sequence);
+	lateFrames.push_back(0);
+	presentedFrame = -1;
+	startWorkers();
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::removeSequence(ofxImageSequence_<PixelType>* sequence)
+{
+	typename vector<ofxImageSequence_<PixelType>*>::iterator it = find(layers.begin(), layers.end(), sequence);
+	if(it == layers.end()){
+		return;
+	}
+
+	stopWorkers();
+	sequence->unlockFrameList();
+	lateFrames.erase(lateFrames.begin() + (it - layers.begin()));
+	layers.erase(it);
+	nextLayer = 0;
+	if(layers.size() > 0){
+		startWorkers();
+	}
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::clear()
+{
+	stopWorkers();
+	for(int i = 0; i < layers.size(); i++){
+		layers[i]->unlockFrameList();
+	}
+	layers.clear();
+	lateFrames.clear();
+	playing = false;
+	targetFrame = 0;
+	presentedFrame = -1;
+	nextLayer = 0;
+}
+
+template<typename PixelType>
+int ofxImageSequenceGroup_<PixelType>::getNumSequences() const
+{
+	return layers.size();
+}
+
+template<typename PixelType>
+ofxImageSequence_<PixelType>* ofxImageSequenceGroup_<PixelType>::getSequence(int layer)
+{
+	if(layer < 0 || layer >= layers.size()){
+		return NULL;
+	}
+	return layers[layer];
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::setNumWorkers(int workers)
+{
+	stopWorkers();
+	numWorkers = MAX(workers, 1);
+	if(layers.size() > 0){
+		startWorkers();
+	}
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::setLookAheadFrames(int frames)
+{
+	ofScopedLock lock(mutex);
+	lookAheadFrames = MAX(frames, 1);
+	jobsChanged.notify_all();
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::setFrameRate(float rate)
+{
+	//restart the clock from the frame that is due so changing the rate doesn't jump
+	playStartFrame = targetFrame;
+	playStartTime = ofGetElapsedTimeMicros();
+	frameRate = rate;
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::setLoop(bool shouldLoop)
+{
+	loop = shouldLoop;
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::play()
+{
+	if(playing){
+		return;
+	}
+	playing = true;
+	playStartFrame = targetFrame;
+	playStartTime = ofGetElapsedTimeMicros();
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::stop()
+{
+	playing = false;
+}
+
+template<typename PixelType>
+bool ofxImageSequenceGroup_<PixelType>::isPlaying() const
+{
+	return playing;
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::setFrame(int index)
+{
+	int numFrames = getTotalFrames();
+	if(numFrames == 0){
+		return;
+	}
+	index = ofClamp(index, 0, numFrames - 1);
+	playStartFrame = index;
+	playStartTime = ofGetElapsedTimeMicros();
+
+	ofScopedLock lock(mutex);
+	targetFrame = index;
+	jobsChanged.notify_all();
+	lock.unlock();
+	present();
+}
+
+template<typename PixelType>
+int ofxImageSequenceGroup_<PixelType>::getCurrentFrame() const
+{
+	return MAX(presentedFrame, 0);
+}
+
+template<typename PixelType>
+int ofxImageSequenceGroup_<PixelType>::getTotalFrames() const
+{
+	int numFrames = 0;
+	for(int i = 0; i < layers.size(); i++){
+		numFrames = i == 0 ? layers[i]->getTotalFrames() : MIN(numFrames, layers[i]->getTotalFrames());
+	}
+	return numFrames;
+}
+
+template<typename PixelType>
+ofxImageSequenceGroupStats ofxImageSequenceGroup_<PixelType>::getStats() const
+{
+	ofxImageSequenceGroupStats stats;
+	stats.framesPresented = framesPresented;
+	stats.framesDropped = framesDropped;
+	stats.lateFrames = lateFrames;
+	return stats;
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::resetStats()
+{
+	framesPresented = 0;
+	framesDropped = 0;
+	lateFrames.assign(layers.size(), 0);
+}
+
+//looking for a job and waiting for one happen under the same lock, so a change notified in between
+//isn't missed. returns false when there is still nothing to do after the idle wait or workers are stopping
+template<typename PixelType>
+bool ofxImageSequenceGroup_<PixelType>::getNextJob(ofxImageSequence_<PixelType>*& sequence, int& frame)
+{
+	ofScopedLock lock(mutex);
+	bool found = false;
+	jobsChanged.wait_for(lock, chrono::milliseconds(OFX_IMAGE_SEQUENCE_GROUP_IDLE_MILLIS), [&](){
+		found = !stoppingWorkers && findJob(sequence, frame);
+		return found || stoppingWorkers;
+	});
+	return found;
+}
+
+//frames are handed out in deadline order: every layer's next frame before any layer's frame after it.
+//among layers with the same deadline the first one looked at rotates, so each gets its turn.
+//called with the mutex locked
+template<typename PixelType>
+bool ofxImageSequenceGroup_<PixelType>::findJob(ofxImageSequence_<PixelType>*& sequence, int& frame)
+{
+	int numFrames = getTotalFrames();
+	int numLayers = layers.size();
+	for(int ahead = 0; ahead < MIN(lookAheadFrames, numFrames); ahead++){
+		int index = targetFrame + ahead;
+		if(index >= numFrames){
+			if(!loop){
+				return false;
+			}
+			index -= numFrames;
+		}
+		for(int i = 0; i < numLayers; i++){
+			int layer = (nextLayer + i) % numLayers;
+			if(!layers[layer]->isFrameClaimed(index)){
+				nextLayer = (layer + 1) % numLayers;
+				sequence = layers[layer];
+				frame = index;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::update(ofEventArgs& args)
+{
+	int numFrames = getTotalFrames();
+	if(numFrames == 0){
+		return;
+	}
+
+	if(playing){
+		int frame = playStartFrame + (ofGetElapsedTimeMicros() - playStartTime) * frameRate / 1000000;
+		if(loop){
+			frame %= numFrames;
+		}
+		else if(frame >= numFrames){
+			frame = numFrames - 1;
+			playing = false;
+		}
+		setTargetFrame(frame, numFrames);
+	}
+	present();
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::setTargetFrame(int frame, int numFrames)
+{
+	if(frame == targetFrame){
+		return;
+	}
+
+	//the frame that was due is skipped if it never made it to the screen, and so is every frame the
+	//clock passed between it and this one. a passed frame is only late on the layers that hadn't decoded it
+	int previousFrame = targetFrame;
+	int skipped = frame - targetFrame - 1;
+	if(loop && skipped < 0){
+		skipped += numFrames;
+	}
+	skipped = MAX(skipped, 0);
+	if(presentedFrame != targetFrame){
+		framesDropped++;
+	}
+	framesDropped += skipped;
+
+	ofScopedLock lock(mutex);
+	targetFrame = frame;
+	jobsChanged.notify_all();
+	lock.unlock();
+
+	for(int i = 0; i < layers.size(); i++){
+		for(int passed = 1; passed <= skipped; passed++){
+			int index = (previousFrame + passed) % numFrames;
+			if(!layers[i]->isFrameReady(index) && !layers[i]->isFrameFailed(index)){
+				lateFrames[i]++;
+			}
+		}
+		if(!layers[i]->isFrameReady(frame) && !layers[i]->isFrameFailed(frame)){
+			lateFrames[i]++;
+		}
+	}
+}
+
+//all layers switch together, until the frame that is due is decoded on every one of them they keep the previous one
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::present()
+{
+	if(presentedFrame == targetFrame){
+		return;
+	}
+	for(int i = 0; i < layers.size(); i++){
+		if(!layers[i]->isFrameReady(targetFrame) && !layers[i]->isFrameFailed(targetFrame)){
+			return;
+		}
+	}
+	for(int i = 0; i < layers.size(); i++){
+		layers[i]->setFrame(targetFrame);
+	}
+	presentedFrame = targetFrame;
+	framesPresented++;
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::startWorkers()
+{
+	for(int i = workers.size(); i < numWorkers; i++){
+		workers.push_back(new ofxImageSequenceGroupWorker_<PixelType>(this));
+	}
+}
+
+template<typename PixelType>
+void ofxImageSequenceGroup_<PixelType>::stopWorkers()
+{
+	for(int i = 0; i < workers.size(); i++){
+		workers[i]->stopThread();
+	}
+	mutex.lock();
+	stoppingWorkers = true;
+	jobsChanged.notify_all();
+	mutex.unlock();
+	for(int i = 0; i < workers.size(); i++){
+		delete workers[i];
+	}
+	workers.clear();
+	mutex.lock();
+	stoppingWorkers = false;
+	mutex.unlock();
+}
+
+template class ofxImageSequenceGroup_<unsigned char>;
+template class ofxImageSequenceGroup_<unsigned short>;
+template class ofxImageSequenceGroup_<float>;
@@ -0,0 +1,102 @@
+/**
+ *  ofxImageSequenceGroup.h
+ *
+ *  Part of ofxImageSequence, see ofxImageSequence.h for license terms.
+ *
+ * ----------------------
+ *
+ *  Plays several sequences in lockstep from one clock. Every layer always shows the same frame
+ *  index: the group holds the current frame on all layers until the next one is decoded on all
+ *  of them, and a layer that is not ready when its frame is due is counted as late.
+ *
+ *  Decoding for all layers runs on one shared pool of worker threads instead of a loader thread
+ *  per sequence. Workers take the frame with the earliest display deadline first and rotate over
+ *  the layers for frames with the same deadline, so a slow layer is not starved by fast ones and
+ *  no layer decodes far ahead while another one is behind.
+ *
+ *  Load the sequences without enableThreadedLoad, add them, then play. The sequences stay owned
+ *  by the app; remove a sequence or clear the group before unloading or deleting it. While a sequence
+ *  is in a group it refuses changes that rebuild its frames, like loading, a region of interest or
+ *  alpha trim, and its folder watch holds rescans until it is removed.
+ */
+
+#pragma once
+
+#include "ofxImageSequence.h"
+#include <condition_variable>
+
+struct ofxImageSequenceGroupStats {
+	uint64_t framesPresented;		//frames shown on all layers
+	uint64_t framesDropped;			//frames that were due but skipped because a layer was not ready in time
+	vector<uint64_t> lateFrames;	//per layer, frames that were not decoded when they were due or when the clock passed them
+};
+
+template<typename PixelType>
+class ofxImageSequenceGroupWorker_;
+
+template<typename PixelType>
+class ofxImageSequenceGroup_ {
+  public:
+	ofxImageSequenceGroup_();
+	~ofxImageSequenceGroup_();
+
+	void addSequence(ofxImageSequence_<PixelType>* sequence);
+	void removeSequence(ofxImageSequence_<PixelType>* sequence);
+	void clear();
+	int getNumSequences() const;
+	ofxImageSequence_<PixelType>* getSequence(int layer);
+
+	void setNumWorkers(int workers);		//default is one less than the number of cores
+	void setLookAheadFrames(int frames);	//how many frames past the current one the workers decode, default 8
+	void setFrameRate(float rate);			//default is 30fps
+	void setLoop(bool loop);				//default is true
+
+	void play();
+	void stop();
+	bool isPlaying() const;
+
+	void setFrame(int index);				//seeks all layers, shown as soon as every layer has it
+	int getCurrentFrame() const;			//the frame all layers are showing
+	int getTotalFrames() const;				//length of the shortest layer
+
+	ofxImageSequenceGroupStats getStats() const;
+	void resetStats();
+
+	//Do not call directly
+	//called internally from the workers and the update event
+	bool getNextJob(ofxImageSequence_<PixelType>*& sequence, int& frame);
+	void update(ofEventArgs& args);
+
+  protected:
+	void startWorkers();
+	void stopWorkers();
+	bool findJob(ofxImageSequence_<PixelType>*& sequence, int& frame);
+	void setTargetFrame(int frame, int numFrames);
+	void present();
+
+	vector<ofxImageSequence_<PixelType>*> layers;
+	vector<ofxImageSequenceGroupWorker_<PixelType>*> workers;
+	int numWorkers;
+	int lookAheadFrames;
+	float frameRate;
+	bool loop;
+
+	bool playing;
+	uint64_t playStartTime;
+	int playStartFrame;
+	int targetFrame;			//the frame that is due
+	int presentedFrame;			//the frame all layers show, -1 before the first one
+	int nextLayer;				//where workers start looking for work among frames with the same deadline
+	bool stoppingWorkers;
+
+	uint64_t framesPresented;
+	uint64_t framesDropped;
+	vector<uint64_t> lateFrames;
+
+	mutable ofMutex mutex;
+	condition_variable jobsChanged;
+};
+
+typedef ofxImageSequenceGroup_<unsigned char> ofxImageSequenceGroup;
+typedef ofxImageSequenceGroup_<unsigned short> ofxShortImageSequenceGroup;
+typedef ofxImageSequenceGroup_<float> ofxFloatImageSequenceGroup;
@@ -0,0 +1,287 @@
+/**
+ *  ofxImageSequenceSharedFrames.cpp
+ *
+ *  Part of ofxImageSequence, see ofxImageSequence.h for license terms.
+ */
+
+#include "ofxImageSequenceSharedFrames.h"
+#include <atomic>
+#include <cerrno>
+
+#ifndef TARGET_WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define SHARED_FRAMES_MAGIC		0x5351464f		//"OFQS"
+#define SHARED_FRAMES_VERSION	2
+#define SHARED_FRAMES_ALIGNMENT	64
+
+#define ENTRY_EMPTY		0
+#define ENTRY_WRITING	1
+#define ENTRY_READY		2
+
+struct ofxImageSequenceSharedFrames::Header {
+	atomic<uint32_t> magic;			//set last by the writer, readers check it before anything else
+	uint32_t version;
+	uint32_t numFrames;
+	uint32_t bytesPerSample;
+	uint64_t dataOffset;
+	uint64_t capacity;
+	atomic<uint64_t> used;
+	atomic<uint64_t> published;		//frames published so far, readers only look for new ones when it changes
+};
+
+struct ofxImageSequenceSharedFrames::Entry {
+	atomic<uint32_t> state;
+	uint32_t width;
+	uint32_t height;
+	uint32_t channels;
+	uint64_t offset;
+	uint64_t publishedMicros;
+};
+
+static uint64_t alignShared(uint64_t offset)
+{
+	return (offset + SHARED_FRAMES_ALIGNMENT - 1) & ~(uint64_t)(SHARED_FRAMES_ALIGNMENT - 1);
+}
+
+ofxImageSequenceSharedFrames::ofxImageSequenceSharedFrames()
+{
+	header = NULL;
+	entries = NULL;
+	data = NULL;
+	mappedSize = 0;
+	writer = false;
+	fullLogged = false;
+}
+
+ofxImageSequenceSharedFrames::~ofxImageSequenceSharedFrames()
+{
+	close();
+}
+
+bool ofxImageSequenceSharedFrames::create(string sharedName, int numFrames, size_t bytesPerSample, uint64_t capacity)
+{
+	close();
+	#ifdef TARGET_WIN32
+	ofLogError("ofxImageSequenceSharedFrames::create") << "Shared frames are not supported on Windows";
+	return false;
+	#else
+	if(sharedName.size() == 0 || sharedName[0] != '/'){
+		sharedName = "/" + sharedName;
+	}
+
+	uint64_t dataOffset = alignShared(sizeof(Header) + numFrames * sizeof(Entry));
+	uint64_t size = dataOffset + capacity;
+
+	int fd = shm_open(sharedName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if(fd < 0 && errno == EEXIST){
+		shm_unlink(sharedName.c_str());
+		fd = shm_open(sharedName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	}
+	if(fd < 0){
+		ofLogError("ofxImageSequenceSharedFrames::create") << "Couldn't create " << sharedName << ": " << strerror(errno);
+		return false;
+	}
+	if(ftruncate(fd, size) != 0){
+		ofLogError("ofxImageSequenceSharedFrames::create") << "Couldn't reserve " << size << " bytes for " << sharedName << ": " << strerror(errno);
+		::close(fd);
+		shm_unlink(sharedName.c_str());
+		return false;
+	}
+	void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(mapping == MAP_FAILED){
+		ofLogError("ofxImageSequenceSharedFrames::create") << "Couldn't map " << sharedName << ": " << strerror(errno);
+		shm_unlink(sharedName.c_str());
+		return false;
+	}
+
+	//the region starts zeroed, so every entry is already empty
+	header = (Header*)mapping;
+	entries = (Entry*)((char*)mapping + sizeof(Header));
+	data = (char*)mapping + dataOffset;
+	mappedSize = size;
+	name = sharedName;
+	writer = true;
+	fullLogged = false;
+
+	header->version = SHARED_FRAMES_VERSION;
+	header->numFrames = numFrames;
+	header->bytesPerSample = bytesPerSample;
+	header->dataOffset = dataOffset;
+	header->capacity = capacity;
+	header->used = 0;
+	header->published = 0;
+	header->magic.store(SHARED_FRAMES_MAGIC, memory_order_release);
+	return true;
+	#endif
+}
+
+bool ofxImageSequenceSharedFrames::attach(string sharedName, size_t bytesPerSample)
+{
+	close();
+	#ifdef TARGET_WIN32
+	ofLogError("ofxImageSequenceSharedFrames::attach") << "Shared frames are not supported on Windows";
+	return false;
+	#else
+	if(sharedName.size() == 0 || sharedName[0] != '/'){
+		sharedName = "/" + sharedName;
+	}
+
+	int fd = shm_open(sharedName.c_str(), O_RDONLY, 0);
+	if(fd < 0){
+		ofLogError("ofxImageSequenceSharedFrames::attach") << "Couldn't open " << sharedName << ": " << strerror(errno);
+		return false;
+	}
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(Header)){
+		ofLogError("ofxImageSequenceSharedFrames::attach") << sharedName << " is not a shared frame region";
+		::close(fd);
+		return false;
+	}
+	void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(mapping == MAP_FAILED){
+		ofLogError("ofxImageSequenceSharedFrames::attach") << "Couldn't map " << sharedName << ": " << strerror(errno);
+		return false;
+	}
+
+	Header* mappedHeader = (Header*)mapping;
+	if(mappedHeader->magic.load(memory_order_acquire) != SHARED_FRAMES_MAGIC ||
+	   mappedHeader->version != SHARED_FRAMES_VERSION ||
+	   mappedHeader->dataOffset + mappedHeader->capacity > (uint64_t)info.st_size){
+		ofLogError("ofxImageSequenceSharedFrames::attach") << sharedName << " is not a shared frame region";
+		munmap(mapping, info.st_size);
+		return false;
+	}
+	if(mappedHeader->bytesPerSample != bytesPerSample){
+		ofLogError("ofxImageSequenceSharedFrames::attach") << sharedName << " holds " << mappedHeader->bytesPerSample * 8
+			<< " bit frames, attach it with a sequence of the same pixel type";
+		munmap(mapping, info.st_size);
+		return false;
+	}
+
+	header = mappedHeader;
+	entries = (Entry*)((char*)mapping + sizeof(Header));
+	data = (char*)mapping + header->dataOffset;
+	mappedSize = info.st_size;
+	name = sharedName;
+	writer = false;
+	return true;
+	#endif
+}
+
+void ofxImageSequenceSharedFrames::close()
+{
+	#ifndef TARGET_WIN32
+	if(header != NULL){
+		munmap(header, mappedSize);
+		if(writer){
+			shm_unlink(name.c_str());
+		}
+	}
+	#endif
+	header = NULL;
+	entries = NULL;
+	data = NULL;
+	mappedSize = 0;
+	name = "";
+	writer = false;
+}
+
+bool ofxImageSequenceSharedFrames::isOpen() const
+{
+	return header != NULL;
+}
+
+bool ofxImageSequenceSharedFrames::isWriter() const
+{
+	return writer;
+}
+
+string ofxImageSequenceSharedFrames::getName() const
+{
+	return name;
+}
+
+int ofxImageSequenceSharedFrames::getNumFrames() const
+{
+	return header != NULL ? header->numFrames : 0;
+}
+
+uint64_t ofxImageSequenceSharedFrames::getCapacity() const
+{
+	return header != NULL ? header->capacity : 0;
+}
+
+uint64_t ofxImageSequenceSharedFrames::getBytesUsed() const
+{
+	return header != NULL ? MIN(header->used.load(), header->capacity) : 0;
+}
+
+bool ofxImageSequenceSharedFrames::publishFrame(int index, const void* pixels, size_t width, size_t height, size_t channels)
+{
+	if(!writer || index < 0 || index >= (int)header->numFrames){
+		return false;
+	}
+
+	//only the first thread to claim the entry writes it
+	uint32_t empty = ENTRY_EMPTY;
+	Entry& entry = entries[index];
+	if(!entry.state.compare_exchange_strong(empty, ENTRY_WRITING)){
+		return false;
+	}
+
+	uint64_t size = (uint64_t)width * height * channels * header->bytesPerSample;
+	uint64_t offset = header->used.fetch_add(alignShared(size));
+	if(offset + size > header->capacity){
+		//full, the entry stays claimed so the frame isn't tried again
+		if(!fullLogged.exchange(true)){
+			ofLogWarning("ofxImageSequenceSharedFrames::publishFrame") << name << " is full at " << header->capacity
+				<< " bytes, frames that don't fit are not shared. Share with a larger capacity";
+		}
+		return false;
+	}
+
+	memcpy(data + offset, pixels, size);
+	entry.width = width;
+	entry.height = height;
+	entry.channels = channels;
+	entry.offset = offset;
+	entry.publishedMicros = ofGetSystemTimeMicros();
+	entry.state.store(ENTRY_READY, memory_order_release);
+	header->published.fetch_add(1, memory_order_release);
+	return true;
+}
+
+uint64_t ofxImageSequenceSharedFrames::getPublishTime(int index) const
+{
+	return isFrameReady(index) ? entries[index].publishedMicros : 0;
+}
+
+uint64_t ofxImageSequenceSharedFrames::getNumPublished() const
+{
+	return header != NULL ? header->published.load(memory_order_acquire) : 0;
+}
+
+bool ofxImageSequenceSharedFrames::isFrameReady(int index) const
+{
+	return header != NULL && index >= 0 && index < (int)header->numFrames &&
+		entries[index].state.load(memory_order_acquire) == ENTRY_READY;
+}
+
+const void* ofxImageSequenceSharedFrames::getFrame(int index, size_t& width, size_t& height, size_t& channels) const
+{
+	if(!isFrameReady(index)){
+		return NULL;
+	}
+	const Entry& entry = entries[index];
+	width = entry.width;
+	height = entry.height;
+	channels = entry.channels;
+	return data + entry.offset;
+}
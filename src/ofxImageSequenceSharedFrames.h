@@ -0,0 +1,64 @@
+/**
+ *  ofxImageSequenceSharedFrames.h
+ *
+ *  Part of ofxImageSequence, see ofxImageSequence.h for license terms.
+ *
+ * ----------------------
+ *
+ *  Decoded frames in a POSIX shared memory region, written by the process that decodes the sequence
+ *  and mapped read only by other processes that show the same frames without decoding them.
+ *
+ *  The region starts with a small header and an index entry per frame, followed by the pixels. The
+ *  writer reserves space for a frame by bumping an atomic offset, copies the pixels in and publishes
+ *  the frame by setting its entry's state, so neither side ever takes a lock. Published frames are
+ *  never moved or overwritten, readers can keep pointers into the mapping for as long as it is open.
+ *
+ *  Not available on Windows. Older glibc versions need the project linked with -lrt.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+#include <atomic>
+
+class ofxImageSequenceSharedFrames {
+  public:
+	ofxImageSequenceSharedFrames();
+	~ofxImageSequenceSharedFrames();
+
+	//names are like "/mySequence". a region left behind by a writer that crashed is replaced
+	bool create(string name, int numFrames, size_t bytesPerSample, uint64_t capacity);
+	bool attach(string name, size_t bytesPerSample);
+	void close();				//the writer also removes the name, readers keep their mapping until they close
+	bool isOpen() const;
+	bool isWriter() const;
+	string getName() const;
+
+	int getNumFrames() const;
+	uint64_t getCapacity() const;
+	uint64_t getBytesUsed() const;
+
+	//copies a frame in and publishes it, false if it was published before or there is no room left.
+	//running out of room is logged once
+	bool publishFrame(int index, const void* pixels, size_t width, size_t height, size_t channels);
+	uint64_t getNumPublished() const;			//grows with every published frame
+	bool isFrameReady(int index) const;
+	uint64_t getPublishTime(int index) const;	//ofGetSystemTimeMicros when the frame was published, 0 until it is
+	const void* getFrame(int index, size_t& width, size_t& height, size_t& channels) const;	//NULL until published
+
+  protected:
+	struct Header;
+	struct Entry;
+
+	Header* header;
+	Entry* entries;
+	char* data;
+	uint64_t mappedSize;
+	string name;
+	bool writer;
+	atomic<bool> fullLogged;
+
+  private:
+	ofxImageSequenceSharedFrames(const ofxImageSequenceSharedFrames&);
+	ofxImageSequenceSharedFrames& operator=(const ofxImageSequenceSharedFrames&);
+};